@@ -29,7 +29,7 @@ struct Job1541State;
 
 class Job1541 {
 public:
-	Job1541(uint8 *ram1541);
+	Job1541(uint8 *ram1541, Prefs *prefs);
 	~Job1541();
 
 	void GetState(Job1541State *state);
@@ -56,6 +56,7 @@ private:
 	void disk2gcr(void);
 
 	uint8 *ram;				// Pointer to 1541 RAM
+	Prefs *the_prefs;		// Pointer to preferences
 	RFILE *the_file;		// File pointer for .d64 file
 	int image_header;		// Length of .d64/.x64 file header
 
@@ -0,0 +1,535 @@
+/*
+ *  Batch.cpp - Headless batch runner
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Notes:
+ * ------
+ *
+ *  - Runs a list of programs (.prg) and disk/tape images (.d64, .x64,
+ *    .t64, .p00, .lnx) for a number of frames each, on a pool of worker
+ *    threads with one C64 per title. Built as "make batch", it links
+ *    the emulation core with Display_Headless.cpp instead of the
+ *    libretro frontend.
+ *  - For every title one line is written to stdout, in the order of
+ *    the input: CRC32 of the last frame's bitmap (color numbers), CRC32
+ *    of the sound output (stereo), emulated frames, emulated and wall
+ *    clock seconds, and the path.
+ *  - The ROM images are loaded once. Every C64 gets a copy as it
+ *    patches its Kernal and 1541 ROM for the IEC and drive emulation.
+ *  - C64 objects are created one at a time, the chip constructors fill
+ *    shared lookup tables. Creation also reseeds rand(), which only
+ *    seeds the random number generator of the new C64, so every title
+ *    starts with the same color RAM and open I/O values however the
+ *    threads are scheduled.
+ *  - Images are run with the 1541 processor emulation, archives with
+ *    the IEC emulation. Programs are copied into RAM after the boot.
+ *    Both are started by typing into the keyboard buffer.
+ *  - With -t (HAVE_THREADS only), every title is run a second time
+ *    with the SID sound calculated in a worker thread. That sound is
+ *    a frame late, so the lead-in is skipped and the run goes on until
+ *    as many samples were added to the CRC as without the thread. A
+ *    different CRC marks the title with "SID THREAD MISMATCH".
+ *  - A second SID also has a lead-in, in the frame it is first written
+ *    to. Without the thread, the frame before still played the first
+ *    SID on the right, so the lead-in is replaced with the left
+ *    channel before it goes into the CRC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <libretro.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include "sysdeps.h"
+
+#include "main.h"
+#include "C64.h"
+#include "Display.h"
+#include "Prefs.h"
+#include "IEC.h"
+#include "VIC.h"
+#include "SID.h"
+
+/* Builtin ROMs */
+#include "Basic_ROM.h"
+#include "Kernal_ROM.h"
+#include "Char_ROM.h"
+#include "1541_ROM.h"
+
+extern "C" {
+RFILE* rfopen(const char *path, const char *mode);
+int rfclose(RFILE* stream);
+int64_t rfread(void* buffer,
+   size_t elem_size, size_t elem_count, RFILE* stream);
+}
+
+// Frames to wait for the READY prompt before typing
+const int BOOT_FRAMES = 150;
+
+// Kinds of titles
+enum {
+	TITLE_PRG,		// Program file, copied into RAM
+	TITLE_IMAGE,	// Disk image, 1541 processor emulation
+	TITLE_ARCH		// Archive, IEC emulation
+};
+
+// One title and its results
+struct BatchJob {
+	const char *path;
+	int type;
+
+	bool ok;				// Title could be loaded
+	uint32 video_crc;		// CRC32 of the last frame
+	uint32 audio_crc;		// CRC32 of all sound output
+	int samples;			// Number of samples in audio_crc
+	bool thread_ok;			// Sound with the SID thread was the same (-t)
+	int frames;				// Emulated frames
+	double wall_time;		// Seconds spent emulating
+};
+
+static BatchJob *jobs;
+static int num_jobs;
+static int next_job;		// Next job for a worker, protected by job_lock
+static int num_frames = 3000;
+static int sid2_address = 0;	// Extra SIDs of all titles (0 = none)
+static int sid3_address = 0;
+static bool check_thread = false;	// Compare the sound with the SID thread (-t)
+
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t create_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ROM images shared by all C64s
+static const uint8 *basic_rom = builtin_basic_rom;
+static const uint8 *kernal_rom = builtin_kernal_rom;
+static const uint8 *char_rom = builtin_char_rom;
+static const uint8 *drive_rom = builtin_drive_rom;
+
+
+/*
+ *  Frontend globals the emulation core refers to
+ */
+
+char AppDirPath[1024];
+const char *retro_system_directory = NULL;	// No power-up snapshots
+int retro_quit = 0;
+int SHOWKEY = -1;
+
+static int16_t batch_input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	return 0;
+}
+
+retro_input_state_t input_state_cb = batch_input_state;
+
+bool IsDirectory(const char *path)
+{
+	return path_is_directory(path);
+}
+
+
+/*
+ *  Load a ROM image from dir, or use the builtin one
+ */
+
+static const uint8 *load_rom(const char *dir, const char *name, size_t size, const uint8 *builtin)
+{
+	char path[1024];
+	uint8 *rom;
+	RFILE *f;
+
+	if (!dir)
+		return builtin;
+
+	fill_pathname_join(path, dir, name, sizeof(path));
+	f = rfopen(path, "rb");
+	if (!f)
+		return builtin;
+
+	rom = new uint8[size];
+	if ((size_t)rfread(rom, 1, size, f) != size)
+	{
+		delete[] rom;
+		rom = NULL;
+	}
+	rfclose(f);
+	if (!rom)
+	{
+		fprintf(stderr, "%s: wrong size, using the builtin ROM\n", path);
+		return builtin;
+	}
+	return rom;
+}
+
+
+/*
+ *  Time in seconds
+ */
+
+static double get_time(void)
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+/*
+ *  Copy a program file into RAM like LOAD"...",8,1 does, returns the
+ *  command that starts it or NULL on error
+ */
+
+static const char *inject_prg(C64 *c64, const char *path, char *cmd)
+{
+	uint8 buf[0x10000 + 2];
+	int64_t size;
+	int start, end;
+	RFILE *f;
+
+	f = rfopen(path, "rb");
+	if (!f)
+		return NULL;
+	size = rfread(buf, 1, sizeof(buf), f);
+	rfclose(f);
+	if (size < 3)
+		return NULL;
+
+	start = buf[0] | (buf[1] << 8);
+	end   = start + (int)size - 2;
+	if (end > 0x10000)
+		end = 0x10000;
+	memcpy(c64->RAM + start, buf + 2, end - start);
+
+	if (start != 0x0801)
+	{
+		sprintf(cmd, "SYS%d\r", start);
+		return cmd;
+	}
+
+	// Set the end of the BASIC program and of the variables
+	c64->RAM[0x2d] = c64->RAM[0x2f] = c64->RAM[0x31] = c64->RAM[0xae] = end & 0xff;
+	c64->RAM[0x2e] = c64->RAM[0x30] = c64->RAM[0x32] = c64->RAM[0xaf] = end >> 8;
+	return "RUN\r";
+}
+
+
+/*
+ *  Run a title, returns the CRC32 of its sound. With sid_thread, the
+ *  lead-in of the SID thread is skipped and the run goes on until the
+ *  CRC covers job->samples samples. Otherwise the results are stored
+ *  in job.
+ */
+
+static uint32 run_title(BatchJob *job, bool sid_thread)
+{
+	Prefs prefs;
+	C64 *c64;
+	char sys_cmd[16];
+	const char *keys = NULL;
+	uint32 audio_crc = 0;
+	int samples = 0, skip = 0, lead = 0;
+	bool sid2_on = false;
+	int frame, i;
+	double start;
+
+	prefs.SkipFrames   = 1;
+	prefs.FastReset    = true;
+	prefs.Emul1541Proc = (job->type == TITLE_IMAGE);
+	prefs.SID2Address  = sid2_address;
+	prefs.SID3Address  = sid3_address;
+	prefs.SIDThread    = sid_thread;
+	strcpy(prefs.DrivePath[0], job->type == TITLE_PRG ? "" : job->path);
+
+	// The fast renderer has no thread and no lead-in
+	if (sid_thread && prefs.SIDType != SIDTYPE_FAST)
+		lead = skip = prefs.SampleRate / CALC_FREQ;
+
+	pthread_mutex_lock(&create_lock);
+	srand(1);
+	c64 = new C64(&prefs);
+	pthread_mutex_unlock(&create_lock);
+
+	memcpy(c64->Basic, basic_rom, BASIC_ROM_SIZE);
+	memcpy(c64->Kernal, kernal_rom, KERNAL_ROM_SIZE);
+	memcpy(c64->Char, char_rom, CHAR_ROM_SIZE);
+	memcpy(c64->ROM1541, drive_rom, DRIVE_ROM_SIZE);
+	c64->Run();
+
+	start = get_time();
+	for (frame = 0; sid_thread ? samples < job->samples : frame < num_frames; frame++)
+	{
+		if (!c64->RunFrame())
+			break;
+
+		// A second SID plays on the right once it was written to. Its
+		// lead-in stands for the frame before, which still had the
+		// first SID there
+		if (!sid2_on && c64->TheSID2 && c64->TheSID2->Active())
+		{
+			sid2_on = true;
+			for (i = 0; i < lead && i < c64->SoundBufLen; i++)
+				c64->SoundBuf[i*2 + 1] = c64->SoundBuf[i*2];
+		}
+
+		// The samples the libretro core plays after this frame
+		const short *buf = c64->SoundBuf;
+		int len = c64->SoundBufLen;
+		int n   = skip < len ? skip : len;
+		buf  += n * 2;
+		len  -= n;
+		skip -= n;
+		if (sid_thread && len > job->samples - samples)
+			len = job->samples - samples;
+		audio_crc = encoding_crc32(audio_crc, (const uint8_t *)buf, len * 4);
+		samples  += len;
+
+		// Start the title when BASIC is ready
+		if (frame == BOOT_FRAMES)
+		{
+			if (job->type == TITLE_PRG)
+				keys = inject_prg(c64, job->path, sys_cmd);
+			else
+				keys = "LOAD\"*\",8,1\rRUN\r";
+			if (!keys)
+				break;
+		}
+
+		// Type one key when the keyboard buffer is empty
+		if (keys && *keys && c64->RAM[198] == 0)
+		{
+			c64->RAM[631] = *keys++;
+			c64->RAM[198] = 1;
+		}
+	}
+	if (!sid_thread)
+	{
+		job->wall_time = get_time() - start;
+		job->frames    = frame;
+		job->samples   = samples;
+		job->ok        = (frame == num_frames);
+		job->video_crc = encoding_crc32(0, c64->TheDisplay->BitmapBase(), DISPLAY_X * DISPLAY_Y);
+	}
+
+	delete c64;
+	return audio_crc;
+}
+
+
+/*
+ *  Run one title
+ */
+
+static void run_job(BatchJob *job)
+{
+	int type;
+
+	job->ok        = false;
+	job->video_crc = 0;
+	job->audio_crc = 0;
+	job->samples   = 0;
+	job->thread_ok = true;
+	job->frames    = 0;
+	job->wall_time = 0;
+
+	if (IsMountableFile(job->path, type))
+		job->type = (type == FILE_IMAGE) ? TITLE_IMAGE : TITLE_ARCH;
+	else if (path_is_valid(job->path))
+		job->type = TITLE_PRG;
+	else
+		return;
+
+	job->audio_crc = run_title(job, false);
+	if (check_thread && job->ok)
+		job->thread_ok = (run_title(job, true) == job->audio_crc);
+}
+
+
+/*
+ *  Worker thread: run jobs until there are none left
+ */
+
+static void *worker(void *arg)
+{
+	int i;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&job_lock);
+		i = next_job++;
+		pthread_mutex_unlock(&job_lock);
+		if (i >= num_jobs)
+			return NULL;
+
+		run_job(&jobs[i]);
+	}
+}
+
+
+/*
+ *  Read the titles of a list file, one path per line
+ */
+
+static void add_list(const char *list_path, char **&paths, int &num, int &max)
+{
+	char line[1024];
+	FILE *f = fopen(list_path, "r");
+	if (!f)
+	{
+		fprintf(stderr, "%s: can't open\n", list_path);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f))
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if (!line[0] || line[0] == '#')
+			continue;
+		if (num == max)
+		{
+			max   = max * 2 + 16;
+			paths = (char **)realloc(paths, max * sizeof(char *));
+		}
+		paths[num++] = strdup(line);
+	}
+	fclose(f);
+}
+
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+			"Usage: %s [-f frames] [-j threads] [-r romdir] [-s sid2[,sid3]]"
+#ifdef HAVE_THREADS
+			" [-t]"
+#endif
+			" [-l listfile] [file...]\n"
+			"  -f  frames to run each title (default 3000)\n"
+			"  -j  worker threads (default: number of CPUs)\n"
+			"  -r  directory with \"Basic ROM\", \"Kernal ROM\", \"Char ROM\", \"1541 ROM\"\n"
+			"  -s  hex addresses of extra SIDs, e.g. d420 or d420,de00\n"
+#ifdef HAVE_THREADS
+			"  -t  check that the sound is the same with the SID thread\n"
+#endif
+			"  -l  file with one title path per line\n", prog);
+}
+
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads;
+	char **paths = NULL;
+	const char *rom_dir = NULL;
+	int num_paths = 0, max_paths = 0;
+	int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int i, opt, mismatches = 0;
+	double start, wall, emulated = 0;
+	char *next;
+
+	while ((opt = getopt(argc, argv, "f:j:r:s:tl:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'f': num_frames = atoi(optarg); break;
+			case 'j': num_threads = atoi(optarg); break;
+			case 'r': rom_dir = optarg; break;
+			case 's':
+				sid2_address = strtoul(optarg, &next, 16);
+				if (*next == ',')
+					sid3_address = strtoul(next + 1, NULL, 16);
+				break;
+#ifdef HAVE_THREADS
+			case 't': check_thread = true; break;
+#endif
+			case 'l': add_list(optarg, paths, num_paths, max_paths); break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	for (i = optind; i < argc; i++)
+	{
+		if (num_paths == max_paths)
+		{
+			max_paths = max_paths * 2 + 16;
+			paths     = (char **)realloc(paths, max_paths * sizeof(char *));
+		}
+		paths[num_paths++] = argv[i];
+	}
+	if (!num_paths || num_frames <= 0)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > num_paths)
+		num_threads = num_paths;
+
+	if (!getcwd(AppDirPath, sizeof(AppDirPath)))
+		strcpy(AppDirPath, ".");
+
+	basic_rom  = load_rom(rom_dir, "Basic ROM", BASIC_ROM_SIZE, builtin_basic_rom);
+	kernal_rom = load_rom(rom_dir, "Kernal ROM", KERNAL_ROM_SIZE, builtin_kernal_rom);
+	char_rom   = load_rom(rom_dir, "Char ROM", CHAR_ROM_SIZE, builtin_char_rom);
+	drive_rom  = load_rom(rom_dir, "1541 ROM", DRIVE_ROM_SIZE, builtin_drive_rom);
+
+	jobs     = new BatchJob[num_paths];
+	num_jobs = num_paths;
+	for (i = 0; i < num_jobs; i++)
+		jobs[i].path = paths[i];
+
+	// Run the titles
+	start   = get_time();
+	threads = new pthread_t[num_threads];
+	for (i = 0; i < num_threads; i++)
+		pthread_create(&threads[i], NULL, worker, NULL);
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	wall = get_time() - start;
+
+	// Report them in the order of the input
+	printf("# video_crc audio_crc frames emulated_s wall_s path\n");
+	for (i = 0; i < num_jobs; i++)
+	{
+		BatchJob *job = &jobs[i];
+		double secs   = (double)job->frames / SCREEN_FREQ;
+
+		printf("%08x %08x %d %.2f %.3f %s%s%s\n",
+				(unsigned)job->video_crc, (unsigned)job->audio_crc, job->frames,
+				secs, job->wall_time, job->path, job->ok ? "" : " FAILED",
+				job->thread_ok ? "" : " SID THREAD MISMATCH");
+		emulated += secs;
+		if (!job->thread_ok)
+			mismatches++;
+	}
+	fprintf(stderr, "%d titles, %.1f s emulated in %.1f s with %d threads (%.1fx)\n",
+			num_jobs, emulated, wall, num_threads, wall > 0 ? emulated / wall : 0);
+
+	if (mismatches)
+		fprintf(stderr, "%d titles sound different with the SID thread\n", mismatches);
+
+	delete[] threads;
+	delete[] jobs;
+	return mismatches ? 1 : 0;
+}
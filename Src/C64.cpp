@@ -19,6 +19,8 @@
  */
 
 #include <libretro.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
 
 #include "sysdeps.h"
 
@@ -40,16 +42,21 @@
 
 #include "main.h"
 
-#ifndef NO_LIBCO
-#include "libco.h"
-#endif
-
 #ifdef FRODO_SC
 bool IsFrodoSC = true;
 #else
 bool IsFrodoSC = false;
 #endif
 
+#ifdef FRODO_HYBRID
+int HybridEngine = ENGINE_AUTO;
+
+// Raster trick score of a frame that makes the hybrid engine run Frodo SC,
+// and the number of frames it keeps running after the last such frame
+const int TRICK_THRESHOLD = 16;
+const int SC_HOLD_FRAMES  = 250;
+#endif
+
 /* Forward declarations */
 extern "C" {
 RFILE* rfopen(const char *path, const char *mode);
@@ -65,29 +72,45 @@ int rfputc(int character, RFILE * stream);
 int rfprintf(RFILE * stream, const char * format, ...);
 }
 extern retro_input_state_t input_state_cb;
-#ifndef NO_LIBCO
-extern cothread_t mainThread;
-extern cothread_t emuThread;
-#endif
 #ifdef SF2000
-extern int pauseg;
 int retro_quit = 0;  // SF2000 stub
 #else
-extern int pauseg,retro_quit;
+extern int retro_quit;
 #endif
-extern void pause_select(void);
 extern int SHOWKEY;
+extern const char *retro_system_directory;
+
+/*
+ *  Sound output rate of the prefs, within what the SID renderers support
+ */
+
+static int sound_output_rate(Prefs *prefs)
+{
+	if (prefs->SampleRate < (int)MIN_OUTPUT_FREQ)
+		return MIN_OUTPUT_FREQ;
+	if (prefs->SampleRate > (int)MAX_OUTPUT_FREQ)
+		return MAX_OUTPUT_FREQ;
+	return prefs->SampleRate;
+}
+
 
 /*
  *  Constructor: Allocate objects and memory
  */
 
-C64::C64()
+C64::C64(Prefs *prefs)
 {
    unsigned i, j;
 	uint8 *p;
 
+	MachinePrefs   = prefs;
+	InstantBoot    = false;
+	rand_seed      = rand();
+	CycleCounter   = 0;		// The chips take their start time from it
+	memset(SoundBuf, 0, sizeof(SoundBuf));
+	SoundBufLen    = 0;
 	quit_thyself   = false;
+	frame_done     = false;
 
 	// System-dependent things
 	c64_ctor1();
@@ -111,7 +134,7 @@ C64::C64()
 	TheCPU         = new MOS6510(this, RAM, Basic, Kernal, Char, Color);
 #endif
 
-	TheJob1541     = new Job1541(RAM1541);
+	TheJob1541     = new Job1541(RAM1541, MachinePrefs);
 	TheCPU1541     = new MOS6502_1541(
          this, TheJob1541, TheDisplay, RAM1541, ROM1541);
 
@@ -122,10 +145,27 @@ C64::C64()
 	TheVIC         = TheCPU->TheVIC  = new MOS6569(this, TheDisplay, TheCPU, RAM, Char, Color);
 	TheSID         = TheCPU->TheSID  = new MOS6581(this);
 #endif
-	TheCIA1        = TheCPU->TheCIA1 = new MOS6526_1(TheCPU, TheVIC);
-	TheCIA2        = TheCPU->TheCIA2 = TheCPU1541->TheCIA2 = new MOS6526_2(TheCPU, TheVIC, TheCPU1541);
-	TheIEC         = TheCPU->TheIEC = new IEC(TheDisplay);
-	TheREU         = TheCPU->TheREU = new REU(TheCPU);
+	TheSID2        = TheSID3 = NULL;
+	sid2_address   = sid3_address = 0;
+	sound_rate     = sound_output_rate(MachinePrefs);
+	sound_div      = 0;
+	sound_count    = 0;
+	map_sids();
+	TheCIA1        = TheCPU->TheCIA1 = new MOS6526_1(TheCPU, TheVIC, MachinePrefs);
+	TheCIA2        = TheCPU->TheCIA2 = TheCPU1541->TheCIA2 = new MOS6526_2(TheCPU, TheVIC, TheCPU1541, MachinePrefs);
+	TheIEC         = TheCPU->TheIEC = new IEC(this);
+	TheREU         = TheCPU->TheREU = new REU(TheCPU, MachinePrefs);
+
+#ifdef FRODO_HYBRID
+	sc_ctor();
+
+	SCActive       = false;
+	trick_raster   = 0xffff;
+	trick_regs     = 0;
+	trick_score    = 0;
+	sc_hold        = 0;
+	memset(trick_value, 0, sizeof(trick_value));
+#endif
 
 	// Initialize RAM with powerup pattern
 	p = RAM;
@@ -140,14 +180,16 @@ C64::C64()
 	// Initialize color RAM with random values
 	p = Color;
 	for (i = 0; i < COLOR_RAM_SIZE; i++)
-		*p++ = rand() & 0x0f;
+		*p++ = Random() & 0x0f;
 
 	// Clear 1541 RAM
 	memset(RAM1541, 0, DRIVE_RAM_SIZE);
 
 	joykey = 0xff;
 
-	CycleCounter = 0;
+	powerup_path[0]      = 0;
+	powerup_save_pending = false;
+	powerup_save_now     = false;
 
 	// System-dependent things
 	c64_ctor2();
@@ -160,11 +202,16 @@ C64::C64()
 
 C64::~C64()
 {
+#ifdef FRODO_HYBRID
+	sc_dtor();
+#endif
 	delete TheJob1541;
 	delete TheREU;
 	delete TheIEC;
 	delete TheCIA2;
 	delete TheCIA1;
+	delete TheSID3;
+	delete TheSID2;
 	delete TheSID;
 	delete TheVIC;
 	delete TheCPU1541;
@@ -189,11 +236,22 @@ C64::~C64()
 
 void C64::Reset(void)
 {
-	TheCPU->AsyncReset();
-	TheCPU1541->AsyncReset();
+#ifdef FRODO_HYBRID
+	if (SCActive)
+		sc_reset();
+	else
+#endif
+	{
+		TheCPU->AsyncReset();
+		TheCPU1541->AsyncReset();
+		TheCIA1->Reset();
+		TheCIA2->Reset();
+	}
 	TheSID->Reset();
-	TheCIA1->Reset();
-	TheCIA2->Reset();
+	if (TheSID2)
+		TheSID2->Reset();
+	if (TheSID3)
+		TheSID3->Reset();
 	TheIEC->Reset();
 	TheDisplay->ResetAutostart();
 }
@@ -205,13 +263,18 @@ void C64::Reset(void)
 
 void C64::NMI(void)
 {
+#ifdef FRODO_HYBRID
+	if (SCActive)
+		sc_nmi();
+	else
+#endif
 	TheCPU->AsyncNMI();
 }
 
 
 /*
  *  The preferences have changed. prefs is a pointer to the new
- *   preferences, ThePrefs still holds the previous ones.
+ *   preferences, MachinePrefs still holds the previous ones.
  *   The emulation must be in the paused state!
  */
 
@@ -226,10 +289,21 @@ void C64::NewPrefs(Prefs *prefs)
 
 	TheREU->NewPrefs(prefs);
 	TheSID->NewPrefs(prefs);
+	if (TheSID2)
+		TheSID2->NewPrefs(prefs);
+	if (TheSID3)
+		TheSID3->NewPrefs(prefs);
 
 	// Reset 1541 processor if turned on
-	if (!ThePrefs.Emul1541Proc && prefs->Emul1541Proc)
-		TheCPU1541->AsyncReset();
+	if (!MachinePrefs->Emul1541Proc && prefs->Emul1541Proc)
+   {
+#ifdef FRODO_HYBRID
+      if (SCActive)
+         sc_reset_1541();
+      else
+#endif
+      TheCPU1541->AsyncReset();
+   }
 }
 
 
@@ -311,7 +385,7 @@ void C64::SaveRAM(char *filename)
       return;
    rfwrite((void*)RAM, 1, 0x10000, f);
    rfwrite((void*)Color, 1, 0x400, f);
-   if (ThePrefs.Emul1541Proc)
+   if (MachinePrefs->Emul1541Proc)
       rfwrite((void*)RAM1541, 1, 0x800, f);
    rfclose(f);
 }
@@ -531,7 +605,7 @@ bool C64::Load1541JobState(RFILE *f)
 	TheCIA1->EmulateCycle(); \
 	TheCIA2->EmulateCycle(); \
 	TheCPU->EmulateCycle(); \
-	if (ThePrefs.Emul1541Proc) { \
+	if (MachinePrefs->Emul1541Proc) { \
 		TheCPU1541->CountVIATimers(1); \
 		if (!TheCPU1541->Idle) \
 			TheCPU1541->EmulateCycle(); \
@@ -554,13 +628,17 @@ void C64::SaveSnapshot(char *filename)
    uint8 flags;
    uint8 delay;
    int stat;
+#ifdef FRODO_HYBRID
+   // Snapshots are always made with the line-based chips
+   switch_engine(false);
+#endif
    if (!(f = rfopen(filename, "wb")))
       return;
 
    rfprintf(f, "%s%c", SNAPSHOT_HEADER, 10);
    rfputc(0, f);	// Version number 0
    flags = 0;
-   if (ThePrefs.Emul1541Proc)
+   if (MachinePrefs->Emul1541Proc)
       flags |= SNAPSHOT_1541;
    rfputc(flags, f);
    SaveVICState(f);
@@ -585,9 +663,9 @@ void C64::SaveSnapshot(char *filename)
    rfputc(0, f);		// No delay
 #endif
 
-   if (ThePrefs.Emul1541Proc)
+   if (MachinePrefs->Emul1541Proc)
    {
-      rfwrite(ThePrefs.DrivePath[0], 256, 1, f);
+      rfwrite(MachinePrefs->DrivePath[0], 256, 1, f);
 #ifdef FRODO_SC
       delay = 0;
       do
@@ -616,6 +694,9 @@ void C64::SaveSnapshot(char *filename)
 bool C64::LoadSnapshot(char *filename)
 {
 	RFILE *f;
+#ifdef FRODO_HYBRID
+	switch_engine(false);
+#endif
 	if ((f = rfopen(filename, "rb")))
    {
       uint8 delay, i;
@@ -670,13 +751,13 @@ bool C64::LoadSnapshot(char *filename)
 #endif
          if ((flags & SNAPSHOT_1541) != 0)
          {
-            Prefs *prefs         = new Prefs(ThePrefs);
+            Prefs *prefs         = new Prefs(*MachinePrefs);
             // First switch on emulation
             error               |= (rfread(prefs->DrivePath[0], 256, 1, f) 
                   != 1);
             prefs->Emul1541Proc  = true;
             NewPrefs(prefs);
-            ThePrefs             = *prefs;
+            *MachinePrefs             = *prefs;
             delete prefs;
 
             // Then read the context
@@ -697,13 +778,13 @@ bool C64::LoadSnapshot(char *filename)
 #endif
             Load1541JobState(f);
          }
-         else if (ThePrefs.Emul1541Proc)
+         else if (MachinePrefs->Emul1541Proc)
          {
             // No emulation in snapshot, but currently active?
-            Prefs *prefs        = new Prefs(ThePrefs);
+            Prefs *prefs        = new Prefs(*MachinePrefs);
             prefs->Emul1541Proc = false;
             NewPrefs(prefs);
-            ThePrefs            = *prefs;
+            *MachinePrefs            = *prefs;
             delete prefs;
          }
 
@@ -726,6 +807,85 @@ bool C64::LoadSnapshot(char *filename)
    return false;
 }
 
+/*
+ *  Power-up snapshot: a "BASIC READY" machine state cached in the system
+ *  directory, so that later sessions can skip the KERNAL cold boot.
+ *  The file name carries a CRC of the loaded ROMs and the settings that
+ *  decide how they are patched, so it is never used with other ROMs.
+ */
+
+#define POWERUP_SNAPSHOT_VERSION 1
+
+bool C64::InitPowerUpSnapshot(void)
+{
+	char name[64];
+	uint32 crc = 0;
+
+	powerup_path[0]      = 0;
+	powerup_save_pending = false;
+	powerup_save_now     = false;
+	InstantBoot          = false;
+
+	if (!retro_system_directory || !*retro_system_directory)
+		return false;
+
+	crc = encoding_crc32(crc, Basic, BASIC_ROM_SIZE);
+	crc = encoding_crc32(crc, Kernal, KERNAL_ROM_SIZE);
+	crc = encoding_crc32(crc, Char, CHAR_ROM_SIZE);
+	crc = encoding_crc32(crc, ROM1541, DRIVE_ROM_SIZE);
+
+	snprintf(name, sizeof(name), "frodo%s_powerup_v%d_%08x_%d%d.fss",
+			IsFrodoSC ? "sc" : "", POWERUP_SNAPSHOT_VERSION, (unsigned)crc,
+			MachinePrefs->FastReset ? 1 : 0, MachinePrefs->Emul1541Proc ? 1 : 0);
+	fill_pathname_join(powerup_path, retro_system_directory, name,
+			sizeof(powerup_path));
+
+	InstantBoot          = path_is_valid(powerup_path);
+	powerup_save_pending = !InstantBoot;
+	return InstantBoot;
+}
+
+
+/*
+ *  Restore the power-up snapshot (emulation must be paused)
+ */
+
+bool C64::LoadPowerUpSnapshot(void)
+{
+	// The snapshot carries the drive settings it was taken with
+	Prefs prefs = *MachinePrefs;
+
+	if (!powerup_path[0] || !LoadSnapshot(powerup_path))
+		return false;
+
+	NewPrefs(&prefs);
+	*MachinePrefs = prefs;
+	return true;
+}
+
+
+/*
+ *  Note when BASIC waits at its first READY prompt (called in VBlank).
+ *  The snapshot itself is taken by RunFrame() after the frame, the
+ *  chips are in the middle of a cycle or line here.
+ */
+
+void C64::check_powerup_snapshot(void)
+{
+	// "READY." in screen codes, printed in row 5 after the banner
+	static const uint8 ready[6] = { 0x12, 0x05, 0x01, 0x04, 0x19, 0x2e };
+
+	if (memcmp(RAM + 0x0400 + 5 * 40, ready, sizeof(ready)) != 0)
+		return;
+
+	// Cursor at the start of row 6 and nothing typed yet
+	if (RAM[0xd6] != 6 || RAM[0xd3] != 0 || RAM[0xc6] != 0 || RAM[0xcc] != 0)
+		return;
+
+	powerup_save_pending = false;
+	powerup_save_now     = true;
+}
+
 /*
  *  C64_x.i - Put the pieces together, X specific stuff
  *
@@ -749,12 +909,16 @@ void C64::c64_dtor(void)
 {
 }
 
-/*  Start main emulation thread */
+/*  Prepare the machine for emulation, frames are run by RunFrame() */
 void C64::Run(void)
 {
 	// Reset chips
 	TheCPU->Reset();
 	TheSID->Reset();
+	if (TheSID2)
+		TheSID2->Reset();
+	if (TheSID3)
+		TheSID3->Reset();
 	TheCIA1->Reset();
 	TheCIA2->Reset();
 	TheCPU1541->Reset();
@@ -765,12 +929,16 @@ void C64::Run(void)
 	// Patch kernal IEC routines
 	orig_kernal_1d84 = Kernal[0x1d84];
 	orig_kernal_1d85 = Kernal[0x1d85];
-	PatchKernal(ThePrefs.FastReset, ThePrefs.Emul1541Proc);
+	PatchKernal(MachinePrefs->FastReset, MachinePrefs->Emul1541Proc);
+
+	// Skip the cold boot if a matching power-up snapshot exists
+	if (InstantBoot && !LoadPowerUpSnapshot())
+	{
+		InstantBoot          = false;
+		powerup_save_pending = powerup_path[0] != 0;
+	}
 
 	quit_thyself     = false;
-#ifndef NO_LIBCO
-	thread_func();
-#endif
 }
 
 /*  Vertical blank: Poll keyboard and joysticks, update window */
@@ -787,7 +955,7 @@ void C64::VBlank(bool draw_frame)
    TheCIA1->Joystick1 = poll_joystick(0);
    TheCIA1->Joystick2 = poll_joystick(1);
 
-   if (ThePrefs.JoystickSwap)
+   if (MachinePrefs->JoystickSwap)
    {
       uint8 tmp          = TheCIA1->Joystick1;
       TheCIA1->Joystick1 = TheCIA1->Joystick2;
@@ -801,18 +969,39 @@ void C64::VBlank(bool draw_frame)
       TheCIA1->Joystick2 &= joykey;
 
    // Count TOD clocks
-   TheCIA1->CountTOD();
-   TheCIA2->CountTOD();
+#ifdef FRODO_HYBRID
+   if (SCActive)
+      sc_vblank(TheCIA1->KeyMatrix, TheCIA1->RevMatrix,
+            TheCIA1->Joystick1, TheCIA1->Joystick2);
+   else
+#endif
+   {
+      TheCIA1->CountTOD();
+      TheCIA2->CountTOD();
+   }
 
    TheDisplay->Update();
 
-   if (pauseg == 1)
-      pause_select();
+   // Sound of the frame that just ended
+   calc_sound();
+
+#ifdef FRODO_HYBRID
+   // Keep Frodo SC running for a while after the last raster trick
+   if (trick_score >= TRICK_THRESHOLD)
+      sc_hold = SC_HOLD_FRAMES;
+   else if (sc_hold)
+      sc_hold--;
+   trick_score  = 0;
+   trick_raster = 0xffff;
+#endif
+
+   if (powerup_save_pending)
+      check_powerup_snapshot();
+
    if (retro_quit == 1)
       quit_thyself = true;
-#ifndef NO_LIBCO
-   co_switch(mainThread);
-#endif
+
+   frame_done = true;
 }
 
 #if defined(SF2000)
@@ -851,67 +1040,290 @@ uint8 C64::poll_joystick(int port)
 }
 
 
-/* The emulation's main loop */
-void C64::thread_func(void)
+/*
+ *  Emulate one frame: returns after the VBlank has been handled, so the
+ *  frontend can drive the machine without a separate emulation thread.
+ *  Returns false when the emulation shall quit.
+ */
+
+bool C64::RunFrame(void)
 {
-	int linecnt = 0;
+	frame_done = false;
+#ifdef FRODO_HYBRID
+	select_engine();
+	if (SCActive)
+		sc_run_frame();
+	else
+#endif
+	while (!frame_done && !quit_thyself)
+		emulate_step();
+
+	// Between frames the snapshot can finish the current instruction
+	// and switch engines
+	if (powerup_save_now)
+	{
+		powerup_save_now = false;
+		SaveSnapshot(powerup_path);
+	}
+	return !quit_thyself;
+}
 
-#ifdef FRODO_SC
-#ifndef NO_LIBCO
-	while (!quit_thyself)
+
+#ifdef FRODO_HYBRID
+/*
+ *  Hybrid engine: look for raster tricks that the line-based VIC can't
+ *  show, called by both VICs for every register write
+ */
+
+void C64::NoteVICWrite(int adr, uint8 byte, int raster)
+{
+	uint8 bit;
+	int i;
+
+	switch (adr)
+	{
+		case 0x11: i = 0; break;	// FLD, line crunch, upper/lower border
+		case 0x16: i = 1; break;	// Side border, tech-tech
+		case 0x18: i = 2; break;	// FLI
+		case 0x20: i = 3; break;	// Color splits
+		case 0x21: i = 4; break;
+		default: return;
+	}
+
+	// Only changes count, RMW instructions write the old value first
+	if (byte == trick_value[i])
+		return;
+	trick_value[i] = byte;
+
+	bit = 1 << i;
+	if (raster != trick_raster)
+	{
+		trick_raster = raster;
+		trick_regs   = 0;
+	}
+
+	if (trick_regs & bit)
+		// Changed again in the same raster line: a mode change in
+		// the middle of the line, color splits need many of them
+		trick_score += i < 3 ? TRICK_THRESHOLD : 1;
+	else if (i < 2)
+		// Scroll/mode change on another line
+		trick_score++;
+	trick_regs |= bit;
+}
+
+
+/*
+ *  Pick the engine for the next frame
+ */
+
+void C64::select_engine(void)
+{
+	bool sc;
+
+	switch (HybridEngine)
+	{
+		case ENGINE_LINE: sc = false; break;
+		case ENGINE_SC:   sc = true; break;
+		default:          sc = sc_hold > 0; break;
+	}
+
+	// The REU does its DMA with the line-based 6510
+	if (MachinePrefs->REUSize != REU_NONE)
+		sc = false;
+
+	switch_engine(sc);
+}
+
+
+/*
+ *  Hand the machine over to the other set of chips (between frames)
+ */
+
+void C64::switch_engine(bool sc)
+{
+	MOS6510State cpu_state;
+	MOS6569State vic_state;
+	MOS6526State cia1_state, cia2_state;
+	MOS6502State drive_state;
+
+	if (sc == SCActive)
+		return;
+
+	if (sc)
+	{
+		TheCPU->GetState(&cpu_state);
+		TheVIC->GetState(&vic_state);
+		TheCIA1->GetState(&cia1_state);
+		TheCIA2->GetState(&cia2_state);
+		TheCPU1541->GetState(&drive_state);
+		sc_set_state(&cpu_state, &vic_state, &cia1_state, &cia2_state, &drive_state);
+	}
+	else
+	{
+		sc_get_state(&cpu_state, &vic_state, &cia1_state, &cia2_state, &drive_state);
+		TheCPU->SetState(&cpu_state);
+		TheVIC->SetState(&vic_state);
+		TheCIA1->SetState(&cia1_state);
+		TheCIA2->SetState(&cia2_state);
+		TheCPU1541->SetState(&drive_state);
+		TheVIC->InvalidateLineCache();
+	}
+
+	SCActive = sc;
+	Display_InvalidateOutput();
+}
 #endif
-    {
-		// The order of calls is important here
-		if (TheVIC->EmulateCycle())
-			TheSID->EmulateLine();
-		TheCIA1->CheckIRQs();
-		TheCIA2->CheckIRQs();
-		TheCIA1->EmulateCycle();
-		TheCIA2->EmulateCycle();
-		TheCPU->EmulateCycle();
-
-		if (ThePrefs.Emul1541Proc)
-      {
-         TheCPU1541->CountVIATimers(1);
-         if (!TheCPU1541->Idle)
-            TheCPU1541->EmulateCycle();
-      }
-		CycleCounter++;
+
+
+/* Slot of a SID at I/O address adr in SIDMap, -1 if no SID can go there */
+static int sid_slot(int adr)
+{
+	if (adr & 0x1f)
+		return -1;
+	if (adr > 0xd400 && adr < 0xd800)
+		return (adr - 0xd400) >> 5;
+	if (adr == 0xde00)
+		return SID_SLOT_IO1;
+	return -1;
+}
+
+
+/* Create the extra SIDs set in the prefs and map all SIDs into the I/O area */
+void C64::map_sids(void)
+{
+	int i;
+	int slot2 = sid_slot(MachinePrefs->SID2Address);
+	int slot3 = sid_slot(MachinePrefs->SID3Address);
+	if (slot3 == slot2)
+		slot3 = -1;
+
+	delete TheSID2;
+	delete TheSID3;
+	TheSID2 = slot2 >= 0 ? new MOS6581(this, true) : NULL;
+	TheSID3 = slot3 >= 0 ? new MOS6581(this, true) : NULL;
+
+	// The main SID is mirrored in all free slots of $d400..$d7ff
+	for (i = 0; i < SID_SLOTS; i++)
+		SIDMap[i] = i < SID_SLOT_IO1 ? TheSID : NULL;
+	if (TheSID2)
+		SIDMap[slot2] = TheSID2;
+	if (TheSID3)
+		SIDMap[slot3] = TheSID3;
+
+	sid2_address = MachinePrefs->SID2Address;
+	sid3_address = MachinePrefs->SID3Address;
+}
+
+
+/* Count the samples of a raster line, advance all SIDs */
+void C64::EmulateSIDLine(void)
+{
+	sound_div += sound_rate;
+	while (sound_div >= 0)
+		sound_div -= TOTAL_RASTERS*SCREEN_FREQ, sound_count++;
+
+	TheSID->EmulateLine();
+	if (TheSID2)
+		TheSID2->EmulateLine();
+	if (TheSID3)
+		TheSID3->EmulateLine();
+}
+
+
+/* Calculate the sound of the frame that just ended into SoundBuf */
+void C64::calc_sound(void)
+{
+	const int16 *sid2 = NULL, *sid3 = NULL;
+
+	// Output frequency changed in the prefs? The renderers switched
+	// at the first line of this frame
+	if (sound_output_rate(MachinePrefs) != sound_rate)
+	{
+		sound_rate = sound_output_rate(MachinePrefs);
+		sound_div  = 0;
+	}
+
+	// Samples of the lines of this frame, at most what the renderers hold
+	int count   = sound_count;
+	sound_count = 0;
+	if (count > sound_rate / (int)CALC_FREQ + 1)
+		count = sound_rate / (int)CALC_FREQ + 1;
+
+	TheSID->VBlank(sid_buf[0], count);
+
+	// Extra SIDs take part once they were written to, each at its
+	// own position in the mix whether the other one is active or not
+	if (TheSID2 && TheSID2->Active())
+	{
+		TheSID2->VBlank(sid_buf[1], count);
+		sid2 = sid_buf[1];
+	}
+	if (TheSID3 && TheSID3->Active())
+	{
+		TheSID3->VBlank(sid_buf[2], count);
+		sid3 = sid_buf[2];
+	}
+
+	MOS6581::Mix(SoundBuf, sid_buf[0], sid2, sid3, count);
+	SoundBufLen = count;
+
+	// SID addresses changed in the prefs directly?
+	if (MachinePrefs->SID2Address != sid2_address
+			|| MachinePrefs->SID3Address != sid3_address)
+		map_sids();
+}
+
+
+/* Emulate one cycle (Frodo SC) or one raster line (Frodo) */
+void C64::emulate_step(void)
+{
+#ifdef FRODO_SC
+	// The order of calls is important here
+	if (TheVIC->EmulateCycle())
+		EmulateSIDLine();
+	TheCIA1->CheckIRQs();
+	TheCIA2->CheckIRQs();
+	TheCIA1->EmulateCycle();
+	TheCIA2->EmulateCycle();
+	TheCPU->EmulateCycle();
+
+	if (MachinePrefs->Emul1541Proc)
+	{
+		TheCPU1541->CountVIATimers(1);
+		if (!TheCPU1541->Idle)
+			TheCPU1541->EmulateCycle();
+	}
+	CycleCounter++;
 #else
-#ifndef NO_LIBCO
-	while (!quit_thyself)
-#endif
- 	{
-		// The order of calls is important here
-		int cycles = TheVIC->EmulateLine();
-		TheSID->EmulateLine();
+	// The order of calls is important here
+	int cycles = TheVIC->EmulateLine();
+	EmulateSIDLine();
 #if !PRECISE_CIA_CYCLES
-		TheCIA1->EmulateLine(ThePrefs.CIACycles);
-		TheCIA2->EmulateLine(ThePrefs.CIACycles);
+	TheCIA1->EmulateLine(MachinePrefs->CIACycles);
+	TheCIA2->EmulateLine(MachinePrefs->CIACycles);
 #endif
 
-		if (ThePrefs.Emul1541Proc)
-      {
-         int cycles_1541 = ThePrefs.FloppyCycles;
-         TheCPU1541->CountVIATimers(cycles_1541);
-
-         if (!TheCPU1541->Idle)
-         {
-            // 1541 processor active, alternately execute
-            //  6502 and 6510 instructions until both have
-            //  used up their cycles
-            while (  cycles >= 0 
-                  || cycles_1541 >= 0)
-               if (cycles > cycles_1541)
-                  cycles      -= TheCPU->EmulateLine(1);
-               else
-                  cycles_1541 -= TheCPU1541->EmulateLine(1);
-         } else
-            TheCPU->EmulateLine(cycles);
-      } else
-			// 1541 processor disabled, only emulate 6510
+	if (MachinePrefs->Emul1541Proc)
+	{
+		int cycles_1541 = MachinePrefs->FloppyCycles;
+		TheCPU1541->CountVIATimers(cycles_1541);
+
+		if (!TheCPU1541->Idle)
+		{
+			// 1541 processor active, alternately execute
+			//  6502 and 6510 instructions until both have
+			//  used up their cycles
+			while (  cycles >= 0 
+					|| cycles_1541 >= 0)
+				if (cycles > cycles_1541)
+					cycles      -= TheCPU->EmulateLine(1);
+				else
+					cycles_1541 -= TheCPU1541->EmulateLine(1);
+		} else
 			TheCPU->EmulateLine(cycles);
+	} else
+		// 1541 processor disabled, only emulate 6510
+		TheCPU->EmulateLine(cycles);
 #endif
-		linecnt++;
-	}
 }
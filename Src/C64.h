@@ -36,10 +36,25 @@ const int CHAR_ROM_SIZE   = 0x1000;
 const int DRIVE_RAM_SIZE  = 0x800;
 const int DRIVE_ROM_SIZE  = 0x4000;
 
+/* SID address slots: 32 bytes each in $d400..$d7ff, then $de00..$de1f */
+const int SID_SLOTS       = 33;
+const int SID_SLOT_IO1    = 32;
+
 
 // false: Frodo, true: FrodoSC
 extern bool IsFrodoSC;
 
+#ifdef FRODO_HYBRID
+// Engine selection of the hybrid build, C64::SCActive tells which one runs
+enum {
+	ENGINE_AUTO,	// Frodo SC only while the program uses raster tricks
+	ENGINE_LINE,	// Always line-based
+	ENGINE_SC		// Always cycle-exact
+};
+
+extern int HybridEngine;
+#endif
+
 class Prefs;
 class C64Display;
 class MOS6510;
@@ -51,13 +66,25 @@ class IEC;
 class REU;
 class MOS6502_1541;
 class Job1541;
+#ifdef FRODO_HYBRID
+struct MOS6510State;
+struct MOS6569State;
+struct MOS6526State;
+struct MOS6502State;
+class MOS6510_SC;
+class MOS6569_SC;
+class MOS6526_1_SC;
+class MOS6526_2_SC;
+class MOS6502_1541_SC;
+#endif
 
 class C64 {
 public:
-	C64();
+	C64(Prefs *prefs);
 	~C64();
 
 	void Run(void);
+	bool RunFrame(void);
 	void Reset(void);
 	void NMI(void);
 	void VBlank(bool draw_frame);
@@ -66,6 +93,8 @@ public:
 	void SaveRAM(char *filename);
 	void SaveSnapshot(char *filename);
 	bool LoadSnapshot(char *filename);
+	bool InitPowerUpSnapshot(void);
+	bool LoadPowerUpSnapshot(void);
 	int SaveCPUState(RFILE *f);
 	int Save1541State(RFILE *f);
 	bool Save1541JobState(RFILE *f);
@@ -88,6 +117,8 @@ public:
 	MOS6510 *TheCPU;			// C64
 	MOS6569 *TheVIC;
 	MOS6581 *TheSID;
+	MOS6581 *TheSID2, *TheSID3;	// Extra SIDs (NULL = none)
+	MOS6581 *SIDMap[SID_SLOTS];	// SID in each address slot (NULL = open I/O)
 	MOS6526_1 *TheCIA1;
 	MOS6526_2 *TheCIA2;
 	IEC *TheIEC;
@@ -97,8 +128,33 @@ public:
 	Job1541 *TheJob1541;
 
 	uint32 CycleCounter;  // Cycle counter for Frodo SC
-#ifdef NO_LIBCO
-	void thread_func(void);
+
+	Prefs *MachinePrefs;		// Preferences of this C64 (ThePrefs in the libretro core)
+	bool InstantBoot;			// Started from the cached power-up snapshot
+
+	short SoundBuf[1024*2*2];	// Sound output of the last frame (stereo)
+	int SoundBufLen;			// Number of stereo samples in SoundBuf
+
+	void EmulateSIDLine(void);
+
+	// Random numbers for color RAM and open I/O, every C64 has its own
+	// generator so machines on other threads don't change the sequence
+	uint8 Random(void)
+	{
+		rand_seed = rand_seed * 1103515245 + 12345;
+		return rand_seed >> 16;
+	}
+
+#ifdef FRODO_HYBRID
+	void NoteVICWrite(int adr, uint8 byte, int raster);
+
+	bool SCActive;				// The Frodo SC chips are running
+
+	MOS6510_SC *TheCPU_SC;		// Frodo SC chips of the hybrid engine
+	MOS6569_SC *TheVIC_SC;
+	MOS6526_1_SC *TheCIA1_SC;
+	MOS6526_2_SC *TheCIA2_SC;
+	MOS6502_1541_SC *TheCPU1541_SC;
 #endif
 
 private:
@@ -106,15 +162,52 @@ private:
 	void c64_ctor2(void);
 	void c64_dtor(void);
 	uint8 poll_joystick(int port);
-#ifndef NO_LIBCO
-	void thread_func(void);
-#endif
-	bool quit_thyself;		// Emulation thread shall quit
+	void check_powerup_snapshot(void);
+	void emulate_step(void);
+	void map_sids(void);
+	void calc_sound(void);
+	bool quit_thyself;		// Emulation shall quit
+	bool frame_done;		// VBlank reached, RunFrame() returns
 
 	uint8 joykey;			// Joystick keyboard emulation mask value
 
 	uint8 orig_kernal_1d84;	// Original contents of kernal locations $1d84 and $1d85
 	uint8 orig_kernal_1d85;	// (for undoing the Fast Reset patch)
+
+	char powerup_path[1024];	// Power-up snapshot for the loaded ROMs
+	bool powerup_save_pending;	// Take the power-up snapshot at the READY prompt
+	bool powerup_save_now;		// READY prompt seen, RunFrame() takes the snapshot
+
+	uint32 rand_seed;		// State of Random()
+
+	int sid2_address;		// SID2Address/SID3Address SIDMap was set up for
+	int sid3_address;
+	int sound_rate;			// Output sample rate the samples are counted for
+	int sound_div;			// Fraction of a sample carried over to the next line
+	int sound_count;		// Samples of the current frame
+	short sid_buf[3][1024*2];	// Sound output of each SID in the last frame
+
+#ifdef FRODO_HYBRID
+	void select_engine(void);
+	void switch_engine(bool sc);
+
+	// Implemented in C64_Hybrid.cpp, with the Frodo SC chips
+	void sc_ctor(void);
+	void sc_dtor(void);
+	void sc_reset(void);
+	void sc_nmi(void);
+	void sc_reset_1541(void);
+	void sc_run_frame(void);
+	void sc_vblank(uint8 *key_matrix, uint8 *rev_matrix, uint8 joy1, uint8 joy2);
+	void sc_get_state(MOS6510State *c, MOS6569State *v, MOS6526State *c1, MOS6526State *c2, MOS6502State *d);
+	void sc_set_state(MOS6510State *c, MOS6569State *v, MOS6526State *c1, MOS6526State *c2, MOS6502State *d);
+
+	int trick_raster;		// Raster line of the last VIC write
+	uint8 trick_regs;		// VIC registers written in that line
+	uint8 trick_value[5];	// Last values of these registers
+	int trick_score;		// Raster tricks seen in this frame
+	int sc_hold;			// Frames to keep Frodo SC running
+#endif
 };
 
 
@@ -0,0 +1,188 @@
+/*
+ *  C64_Hybrid.cpp - Frodo SC chips of the hybrid engine
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Notes:
+ * ------
+ *
+ *  - These are the parts of C64 that work with the Frodo SC chips.
+ *    C64.cpp only sees the line-based chip classes, see Hybrid.h.
+ *  - The engines are switched between frames, right after the VBlank,
+ *    by handing over the snapshot states of the chips. The cycle-exact
+ *    6510 and 6502 are first advanced to an instruction boundary.
+ */
+
+#include <string.h>
+
+#include "Hybrid.h"
+#include "CPUC64.h"
+#include "VIC.h"
+#include "CIA.h"
+#include "CPU1541.h"
+
+// Cycles to wait for both processors to finish an instruction at the
+// same time before the state is handed over anyway
+const int MAX_SYNC_CYCLES = 1000;
+
+
+/*
+ *  Create the Frodo SC chips, sharing memory and the other
+ *  components with the line-based ones
+ */
+
+void C64::sc_ctor(void)
+{
+	TheCPU_SC          = new MOS6510(this, RAM, Basic, Kernal, Char, Color);
+	TheCPU1541_SC      = new MOS6502_1541(
+         this, TheJob1541, TheDisplay, RAM1541, ROM1541);
+
+	TheVIC_SC          = TheCPU_SC->TheVIC  = new MOS6569(this, TheDisplay, TheCPU_SC, RAM, Char, Color);
+	TheCPU_SC->TheSID  = TheSID;
+	TheCIA1_SC         = TheCPU_SC->TheCIA1 = new MOS6526_1(TheCPU_SC, TheVIC_SC, MachinePrefs);
+	TheCIA2_SC         = TheCPU_SC->TheCIA2 = TheCPU1541_SC->TheCIA2 = new MOS6526_2(TheCPU_SC, TheVIC_SC, TheCPU1541_SC, MachinePrefs);
+	TheCPU_SC->TheIEC  = TheIEC;
+	TheCPU_SC->TheREU  = TheREU;
+}
+
+
+/*
+ *  Delete the Frodo SC chips
+ */
+
+void C64::sc_dtor(void)
+{
+	delete TheCIA2_SC;
+	delete TheCIA1_SC;
+	delete TheVIC_SC;
+	delete TheCPU1541_SC;
+	delete TheCPU_SC;
+}
+
+
+/*
+ *  Reset/NMI while Frodo SC is running
+ */
+
+void C64::sc_reset(void)
+{
+	TheCPU_SC->AsyncReset();
+	TheCPU1541_SC->AsyncReset();
+	TheCIA1_SC->Reset();
+	TheCIA2_SC->Reset();
+}
+
+void C64::sc_nmi(void)
+{
+	TheCPU_SC->AsyncNMI();
+}
+
+void C64::sc_reset_1541(void)
+{
+	TheCPU1541_SC->AsyncReset();
+}
+
+
+/*
+ *  Emulate one cycle, like C64::emulate_step() of Frodo SC
+ */
+
+static inline void emulate_cycle(C64 *c64)
+{
+	// The order of calls is important here
+	if (c64->TheVIC_SC->EmulateCycle())
+		c64->EmulateSIDLine();
+	c64->TheCIA1_SC->CheckIRQs();
+	c64->TheCIA2_SC->CheckIRQs();
+	c64->TheCIA1_SC->EmulateCycle();
+	c64->TheCIA2_SC->EmulateCycle();
+	c64->TheCPU_SC->EmulateCycle();
+
+	if (c64->MachinePrefs->Emul1541Proc)
+	{
+		c64->TheCPU1541_SC->CountVIATimers(1);
+		if (!c64->TheCPU1541_SC->Idle)
+			c64->TheCPU1541_SC->EmulateCycle();
+	}
+	c64->CycleCounter++;
+}
+
+
+/*
+ *  Emulate one frame with the Frodo SC chips
+ */
+
+void C64::sc_run_frame(void)
+{
+	while (!frame_done && !quit_thyself)
+		emulate_cycle(this);
+}
+
+
+/*
+ *  VBlank: Keyboard and joysticks were polled into the line-based CIA 1
+ */
+
+void C64::sc_vblank(uint8 *key_matrix, uint8 *rev_matrix, uint8 joy1, uint8 joy2)
+{
+	memcpy(TheCIA1_SC->KeyMatrix, key_matrix, sizeof(TheCIA1_SC->KeyMatrix));
+	memcpy(TheCIA1_SC->RevMatrix, rev_matrix, sizeof(TheCIA1_SC->RevMatrix));
+	TheCIA1_SC->Joystick1 = joy1;
+	TheCIA1_SC->Joystick2 = joy2;
+
+	// Count TOD clocks
+	TheCIA1_SC->CountTOD();
+	TheCIA2_SC->CountTOD();
+}
+
+
+/*
+ *  Get the state of the Frodo SC chips, at an instruction boundary
+ */
+
+void C64::sc_get_state(MOS6510State *c, MOS6569State *v, MOS6526State *c1, MOS6526State *c2, MOS6502State *d)
+{
+	for (int i = 0; i < MAX_SYNC_CYCLES; i++)
+	{
+		TheCPU_SC->GetState(c);
+		TheCPU1541_SC->GetState(d);
+		if (c->instruction_complete
+				&& (!MachinePrefs->Emul1541Proc || d->idle || d->instruction_complete))
+			break;
+		emulate_cycle(this);
+	}
+
+	TheVIC_SC->GetState(v);
+	TheCIA1_SC->GetState(c1);
+	TheCIA2_SC->GetState(c2);
+}
+
+
+/*
+ *  Continue with the Frodo SC chips from the given state
+ */
+
+void C64::sc_set_state(MOS6510State *c, MOS6569State *v, MOS6526State *c1, MOS6526State *c2, MOS6502State *d)
+{
+	TheCPU_SC->SetState(c);
+	TheVIC_SC->SetState(v);
+	TheCIA1_SC->SetState(c1);
+	TheCIA2_SC->SetState(c2);
+	TheCPU1541_SC->SetState(d);
+}
@@ -53,9 +53,9 @@
  *  Constructors
  */
 
-MOS6526::MOS6526(MOS6510 *CPU) : the_cpu(CPU) {}
-MOS6526_1::MOS6526_1(MOS6510 *CPU, MOS6569 *VIC) : MOS6526(CPU), the_vic(VIC) {}
-MOS6526_2::MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541) : MOS6526(CPU), the_vic(VIC), the_cpu_1541(CPU1541) {}
+MOS6526::MOS6526(MOS6510 *CPU, Prefs *prefs) : the_cpu(CPU), the_prefs(prefs) {}
+MOS6526_1::MOS6526_1(MOS6510 *CPU, MOS6569 *VIC, Prefs *prefs) : MOS6526(CPU, prefs), the_vic(VIC) {}
+MOS6526_2::MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541, Prefs *prefs) : MOS6526(CPU, prefs), the_vic(VIC), the_cpu_1541(CPU1541) {}
 
 
 /*
@@ -339,7 +339,7 @@ void MOS6526_1::WriteRegister(uint16 adr, uint8 byte)
 			break;
 
 		case 0xd:
-			if (ThePrefs.CIAIRQHack)	// Hack for addressing modes that read from the address
+			if (the_prefs->CIAIRQHack)	// Hack for addressing modes that read from the address
 				icr = 0;
 			if (byte & 0x80) {
 				int_mask |= byte & 0x7f;
@@ -444,7 +444,7 @@ void MOS6526_2::WriteRegister(uint16 adr, uint8 byte)
 			break;
 
 		case 0xd:
-			if (ThePrefs.CIAIRQHack)
+			if (the_prefs->CIAIRQHack)
 				icr = 0;
 			if (byte & 0x80) {
 				int_mask |= byte & 0x7f;
@@ -32,7 +32,7 @@ struct MOS6526State;
 
 class MOS6526 {
 public:
-	MOS6526(MOS6510 *CPU);
+	MOS6526(MOS6510 *CPU, Prefs *prefs);
 
 	void Reset(void);
 	void GetState(MOS6526State *cs);
@@ -48,6 +48,7 @@ public:
 
 protected:
 	MOS6510 *the_cpu;	// Pointer to 6510
+	Prefs *the_prefs;	// Pointer to preferences
 
 	uint8 pra, prb, ddra, ddrb;
 
@@ -83,7 +84,7 @@ protected:
 
 class MOS6526_1 : public MOS6526 {
 public:
-	MOS6526_1(MOS6510 *CPU, MOS6569 *VIC);
+	MOS6526_1(MOS6510 *CPU, MOS6569 *VIC, Prefs *prefs);
 
 	void Reset(void);
 	uint8 ReadRegister(uint16 adr);
@@ -107,7 +108,7 @@ private:
 
 class MOS6526_2 : public MOS6526{
 public:
-	MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541);
+	MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541, Prefs *prefs);
 
 	void Reset(void);
 	uint8 ReadRegister(uint16 adr);
@@ -66,9 +66,9 @@ enum {
  *  Constructors
  */
 
-MOS6526::MOS6526(MOS6510 *CPU) : the_cpu(CPU) {}
-MOS6526_1::MOS6526_1(MOS6510 *CPU, MOS6569 *VIC) : MOS6526(CPU), the_vic(VIC) {}
-MOS6526_2::MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541) : MOS6526(CPU), the_vic(VIC), the_cpu_1541(CPU1541) {}
+MOS6526::MOS6526(MOS6510 *CPU, Prefs *prefs) : the_cpu(CPU), the_prefs(prefs) {}
+MOS6526_1::MOS6526_1(MOS6510 *CPU, MOS6569 *VIC, Prefs *prefs) : MOS6526(CPU, prefs), the_vic(VIC) {}
+MOS6526_2::MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541, Prefs *prefs) : MOS6526(CPU, prefs), the_vic(VIC), the_cpu_1541(CPU1541) {}
 
 
 /*
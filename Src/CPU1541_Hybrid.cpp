@@ -0,0 +1,24 @@
+/*
+ *  CPU1541_Hybrid.cpp - 6502 (1541) emulation of Frodo SC for the hybrid engine
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Same as CPU1541_SC.cpp, but with the class names of Hybrid.h so that it
+// can be linked next to CPU1541.cpp (FRODO_HYBRID)
+#include "Hybrid.h"
+#include "CPU1541_SC.cpp"
@@ -174,22 +174,24 @@ inline uint8 MOS6510::read_byte_io(uint16 adr)
 					case 0x5:
 					case 0x6:
 					case 0x7:
-						return TheSID->ReadRegister(adr & 0x1f);
+						return the_c64->SIDMap[(adr >> 5) & 0x1f]->ReadRegister(adr & 0x1f);
 					case 0x8:	// Color RAM
 					case 0x9:
 					case 0xa:
 					case 0xb:
-						return color_ram[adr & 0x03ff] | rand() & 0xf0;
+						return color_ram[adr & 0x03ff] | the_c64->Random() & 0xf0;
 					case 0xc:	// CIA 1
 						return TheCIA1->ReadRegister(adr & 0x0f);
 					case 0xd:	// CIA 2
 						return TheCIA2->ReadRegister(adr & 0x0f);
-					case 0xe:	// REU/Open I/O
+					case 0xe:	// SID/REU/Open I/O
 					case 0xf:
-						if ((adr & 0xfff0) == 0xdf00)
+						if ((adr & 0xffe0) == 0xde00 && the_c64->SIDMap[SID_SLOT_IO1])
+							return the_c64->SIDMap[SID_SLOT_IO1]->ReadRegister(adr & 0x1f);
+						else if ((adr & 0xfff0) == 0xdf00)
 							return TheREU->ReadRegister(adr & 0x0f);
 						else if (adr < 0xdfa0)
-							return rand();
+							return the_c64->Random();
 						else
 							return read_emulator_id(adr & 0x7f);
 				}
@@ -325,7 +327,7 @@ void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 			case 0x5:
 			case 0x6:
 			case 0x7:
-				TheSID->WriteRegister(adr & 0x1f, byte);
+				the_c64->SIDMap[(adr >> 5) & 0x1f]->WriteRegister(adr & 0x1f, byte);
 				return;
 			case 0x8:	// Color RAM
 			case 0x9:
@@ -339,9 +341,11 @@ void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 			case 0xd:	// CIA 2
 				TheCIA2->WriteRegister(adr & 0x0f, byte);
 				return;
-			case 0xe:	// REU/Open I/O
+			case 0xe:	// SID/REU/Open I/O
 			case 0xf:
-				if ((adr & 0xfff0) == 0xdf00)
+				if ((adr & 0xffe0) == 0xde00 && the_c64->SIDMap[SID_SLOT_IO1])
+					the_c64->SIDMap[SID_SLOT_IO1]->WriteRegister(adr & 0x1f, byte);
+				else if ((adr & 0xfff0) == 0xdf00)
 					TheREU->WriteRegister(adr & 0x0f, byte);
 				return;
 		}
@@ -83,11 +83,6 @@
 #include "Version.h"
 
 
-enum {
-	INT_RESET = 3
-};
-
-
 /*
  *  6510 constructor: Initialize registers
  */
@@ -240,7 +235,7 @@ inline uint8 MOS6510::read_byte_io(uint16 adr)
 					case 0x5:
 					case 0x6:
 					case 0x7:
-						return TheSID->ReadRegister(adr & 0x1f);
+						return the_c64->SIDMap[(adr >> 5) & 0x1f]->ReadRegister(adr & 0x1f);
 					case 0x8:	// Color RAM
 					case 0x9:
 					case 0xa:
@@ -250,9 +245,11 @@ inline uint8 MOS6510::read_byte_io(uint16 adr)
 						return TheCIA1->ReadRegister(adr & 0x0f);
 					case 0xd:	// CIA 2
 						return TheCIA2->ReadRegister(adr & 0x0f);
-					case 0xe:	// REU/Open I/O
+					case 0xe:	// SID/REU/Open I/O
 					case 0xf:
-						if ((adr & 0xfff0) == 0xdf00)
+						if ((adr & 0xffe0) == 0xde00 && the_c64->SIDMap[SID_SLOT_IO1])
+							return the_c64->SIDMap[SID_SLOT_IO1]->ReadRegister(adr & 0x1f);
+						else if ((adr & 0xfff0) == 0xdf00)
 							return TheREU->ReadRegister(adr & 0x0f);
 						else if (adr < 0xdfa0)
 							return TheVIC->LastVICByte;
@@ -353,7 +350,7 @@ inline void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 			case 0x5:
 			case 0x6:
 			case 0x7:
-				TheSID->WriteRegister(adr & 0x1f, byte);
+				the_c64->SIDMap[(adr >> 5) & 0x1f]->WriteRegister(adr & 0x1f, byte);
 				return;
 			case 0x8:	// Color RAM
 			case 0x9:
@@ -367,9 +364,11 @@ inline void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 			case 0xd:	// CIA 2
 				TheCIA2->WriteRegister(adr & 0x0f, byte);
 				return;
-			case 0xe:	// REU/Open I/O
+			case 0xe:	// SID/REU/Open I/O
 			case 0xf:
-				if ((adr & 0xfff0) == 0xdf00)
+				if ((adr & 0xffe0) == 0xde00 && the_c64->SIDMap[SID_SLOT_IO1])
+					the_c64->SIDMap[SID_SLOT_IO1]->WriteRegister(adr & 0x1f, byte);
+				else if ((adr & 0xfff0) == 0xdf00)
 					TheREU->WriteRegister(adr & 0x0f, byte);
 				return;
 		}
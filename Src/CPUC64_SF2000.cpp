@@ -16,6 +16,7 @@
 #include "SID.h"
 #include "CIA.h"
 #include "IEC.h" // Added for IEC class definition
+#include "TableGen.h"
 
 #ifdef SF2000_FAST_CPU
 #include "CPUC64_SF2000_flags.h"
@@ -54,8 +55,25 @@
 #define read_byte_imm() read_byte(pc++)
 #endif
 
-// Static lookup tables
-FlagLookup MOS6510_SF2000::flag_lookup;
+// Static lookup tables, generated at compile time
+// adc/sbc/cmp_table: A or the register is i >> 1, the operand i & 0xff
+#define FLAG_NZ(i)  (((i) == 0 ? 2 : 0) | ((i) & 0x80))
+#define ADC_SUM(i)  (((i) >> 1) + ((i) & 0xff))
+#define SUB_DIFF(i) ((((i) >> 1) - ((i) & 0xff)) & 0xffff)
+#define FLAG_ADC(i) ((ADC_SUM(i) & 0x100 ? 1 : 0) | (ADC_SUM(i) == 0 ? 2 : 0) | (ADC_SUM(i) & 0x80))
+#define FLAG_SUB(i) ((SUB_DIFF(i) < 0x100 ? 1 : 0) | ((SUB_DIFF(i) & 0xff) == 0 ? 2 : 0) | (SUB_DIFF(i) & 0x80))
+const FlagLookup MOS6510_SF2000::flag_lookup = {
+    { TABLE_256(FLAG_NZ, 0) },
+    { TABLE_512(FLAG_ADC, 0) },
+    { TABLE_512(FLAG_SUB, 0) },
+    { TABLE_512(FLAG_SUB, 0) }
+};
+#undef FLAG_NZ
+#undef ADC_SUM
+#undef SUB_DIFF
+#undef FLAG_ADC
+#undef FLAG_SUB
+
 bool MOS6510_SF2000::tables_initialized = false;
 
 #ifdef SF2000_COMPUTED_GOTO
@@ -69,7 +87,6 @@ MOS6510_SF2000::MOS6510_SF2000(C64 *c64, uint8 *Ram, uint8 *Basic, uint8 *Kernal
     : MOS6510(c64, Ram, Basic, Kernal, Char, Color)
 {
     if (!tables_initialized) {
-        InitializeFastTables();
         InitializeDispatchTable();
         tables_initialized = true;
     }
@@ -96,41 +113,6 @@ MOS6510_SF2000::MOS6510_SF2000(C64 *c64, uint8 *Ram, uint8 *Basic, uint8 *Kernal
     ram_pointer = Ram;
 }
 
-/*
- * Initialize fast lookup tables for flag calculations
- */
-void MOS6510_SF2000::InitializeFastTables()
-{
-    // Initialize N and Z flag lookup table
-    for (int i = 0; i < 256; i++) {
-        flag_lookup.nz_table[i] = (i == 0 ? 2 : 0) | (i & 0x80);
-    }
-    
-    // Initialize ADC lookup table (simplified for common cases)
-    for (int i = 0; i < 512; i++) {
-        uint8 a = i >> 1;
-        uint8 operand = i & 0xFF;
-        uint16 result = a + operand;
-        flag_lookup.adc_table[i] = ((result & 0x100) ? 1 : 0) | ((result == 0) ? 2 : 0) | (result & 0x80);
-    }
-    
-    // Initialize SBC lookup table
-    for (int i = 0; i < 512; i++) {
-        uint8 a = i >> 1;
-        uint8 operand = i & 0xFF;
-        uint16 result = a - operand;
-        flag_lookup.sbc_table[i] = ((result < 0x100) ? 1 : 0) | ((result & 0xFF) == 0 ? 2 : 0) | (result & 0x80);
-    }
-    
-    // Initialize CMP lookup table
-    for (int i = 0; i < 512; i++) {
-        uint8 reg = i >> 1;
-        uint8 operand = i & 0xFF;
-        uint16 result = reg - operand;
-        flag_lookup.cmp_table[i] = ((result < 0x100) ? 1 : 0) | ((result & 0xFF) == 0 ? 2 : 0) | (result & 0x80);
-    }
-}
-
 /*
  * Initialize computed goto dispatch table
  */
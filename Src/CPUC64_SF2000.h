@@ -71,7 +71,6 @@ public:
     // Fast emulation methods  
     int EmulateLineFast(int cycles_left);
     int EmulateLineComputedGoto(int cycles_left);
-    void InitializeFastTables();
     
     // Memory access optimizations
     inline uint8 ReadMemoryFast(uint16 addr);
@@ -85,7 +84,7 @@ public:
     
 private:
     // Fast lookup tables
-    static FlagLookup flag_lookup;
+    static const FlagLookup flag_lookup;
     static bool tables_initialized;
     
     // Fast instruction dispatch table
@@ -27,6 +27,7 @@
 #include "retro_video.h"
 
 #include "C64.h"
+#include "VIC.h"
 #ifdef HAVE_SAM
 #include "SAM.h"
 #endif
@@ -37,6 +38,15 @@
 #include "graph.h"
 #include "vkbd_def.h"
 
+// Vector kernels for the palette expansion in Update()
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EXPAND_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define EXPAND_SSSE3 1
+#endif
+
 /* LED states */
 enum
 {
@@ -73,6 +83,34 @@ int CTRLON=-1;
 int RSTOPON=-1;
 static int vkx=0,vky=0;
 unsigned int mpal[21];
+uint16 mpal16[21];	// mpal in RGB565
+
+// mpal/mpal16 split into byte planes (B, G, R, X and low, high) for
+// the vector kernels
+static uint8 mpal_planes[4][32];
+static uint8 mpal16_planes[2][32];
+
+// Scaler tables: source column and source line offset for every output
+// pixel and line, rebuilt by Display_UpdateScaler()
+static int scale_x[WINDOW_WIDTH];
+static int scale_y[WINDOW_HEIGHT];
+static bool scale_x_identity = false;
+static bool scale_y_identity = false;
+static int scale_src_y;		// Source line of the first output line
+
+// Output buffer that still holds the last converted frame, NULL if
+// all lines have to be converted
+static void *valid_output = NULL;
+static int valid_pitch, valid_led_rows;
+
+// Frame being converted, set up by begin_frame()
+static bool frame_begun = false;
+static bool frame_full;		// Convert all lines, not only the changed ones
+static bool frame_fused;	// Convert VIC lines as soon as they are finished
+static int frame_changed;	// Lines converted by ConvertLine()
+static int frame_led_y0, frame_led_y1;	// LED bar lines, left to Update()
+
+int Display_ChangedLines = WINDOW_HEIGHT;
 
 extern int retrow; 
 extern int retroh;
@@ -305,10 +343,21 @@ void draw_string(retro_Surface *s, int x, int y, const char *str, uint8 front_co
 void Screen_SetFullUpdate(int scr)
 {
    if(scr==0 ||scr>1)
+   {
       memset(Retro_Screen, 0, sizeof(Retro_Screen));
+      Display_InvalidateOutput();
+   }
    if(scr>0)
+   {
       if(screen)
          memset(screen->pixels,0,screen->h*screen->pitch);
+      if(c64_disp)
+         memset(c64_disp->line_dirty, 1, sizeof(c64_disp->line_dirty));
+#ifndef FRODO_SC
+      if(TheC64)
+         TheC64->TheVIC->InvalidateLineCache();
+#endif
+   }
 }
 
 
@@ -447,14 +496,22 @@ C64Display::C64Display(C64 *the_c64) : TheC64(the_c64)
 {
    unsigned i;
 	quit_requested = false;
+	bitmap         = NULL;	// Draws into the frontend's screen surface
 
 	// LEDs off
 	for (i = 0; i < 4; i++)
 		led_state[i] = old_led_state[i] = LED_OFF;
 
+	// Nothing converted yet
+	memset(line_dirty, 1, sizeof(line_dirty));
+	frame_begun = false;
+	Display_InvalidateOutput();
+
 	// Start timer for LED error blinking
 	c64_disp = this;
 	libretro_pulse_handler((void (*)(int))C64Display::pulse_handler);
+
+	Display_UpdateScaler();
 }
 
 /*
@@ -486,15 +543,360 @@ extern short shiftstate;
 extern short joystickport;
 #endif
 
+/*
+ *  Rebuild the scaler tables, called whenever the overscan or
+ *  resolution options change
+ */
+
+void Display_UpdateScaler(void)
+{
+	const int screen_w = DISPLAY_X;
+	const int screen_h = DISPLAY_Y + 16;
+	int x, y;
+
+	// Apply overscan cropping
+	int src_x = overscan_crop_left;
+	int src_y = overscan_crop_top;
+	int src_w = screen_w - overscan_crop_left - overscan_crop_right;
+	int src_h = screen_h - overscan_crop_top - overscan_crop_bottom;
+
+	// Bounds checking
+	if (src_x < 0) src_x = 0;
+	if (src_y < 0) src_y = 0;
+	if (src_x + src_w > screen_w) src_w = screen_w - src_x;
+	if (src_y + src_h > screen_h) src_h = screen_h - src_y;
+	if (src_w <= 0) src_w = screen_w;
+	if (src_h <= 0) src_h = screen_h;
+
+	// Map destination lines/columns to source with scaling
+	for (y = 0; y < retroh && y < WINDOW_HEIGHT; y++)
+   {
+      int src_line_y = (y * src_h) / retroh;
+      if (src_line_y >= src_h) src_line_y = src_h - 1;
+      scale_y[y] = (src_y + src_line_y) * screen_w;
+   }
+
+	for (x = 0; x < retrow && x < WINDOW_WIDTH; x++)
+   {
+      int src_x_offset = (x * src_w) / retrow;
+      if (src_x_offset >= src_w) src_x_offset = src_w - 1;
+      scale_x[x] = src_x + src_x_offset;
+   }
+
+	scale_x_identity = (src_w == retrow);
+	scale_y_identity = (src_h == retroh);
+	scale_src_y      = src_y;
+
+	// The LED bar may have moved in the chunky buffer
+#ifndef FRODO_SC
+	if (TheC64 && TheC64->TheVIC)
+		TheC64->TheVIC->InvalidateLineCache();
+#endif
+	Display_InvalidateOutput();
+}
+
+
+void Display_InvalidateOutput(void)
+{
+	valid_output = NULL;
+}
+
+
+/*
+ *  Convert a run of chunky pixels to output pixels through mpal
+ */
+
+static void expand_pixels(uint32 *dst, const uint8 *src, int n)
+{
+#if defined(EXPAND_NEON) && defined(__aarch64__)
+	const uint8x16x2_t b = {{ vld1q_u8(mpal_planes[0]), vld1q_u8(mpal_planes[0] + 16) }};
+	const uint8x16x2_t g = {{ vld1q_u8(mpal_planes[1]), vld1q_u8(mpal_planes[1] + 16) }};
+	const uint8x16x2_t r = {{ vld1q_u8(mpal_planes[2]), vld1q_u8(mpal_planes[2] + 16) }};
+	const uint8x16x2_t a = {{ vld1q_u8(mpal_planes[3]), vld1q_u8(mpal_planes[3] + 16) }};
+
+	for (; n >= 16; n -= 16, src += 16, dst += 16)
+   {
+      uint8x16_t   idx = vld1q_u8(src);
+      uint8x16x4_t px;
+      px.val[0] = vqtbl2q_u8(b, idx);
+      px.val[1] = vqtbl2q_u8(g, idx);
+      px.val[2] = vqtbl2q_u8(r, idx);
+      px.val[3] = vqtbl2q_u8(a, idx);
+      vst4q_u8((uint8_t *)dst, px);
+   }
+#elif defined(EXPAND_NEON)
+	const uint8x8x4_t b = {{ vld1_u8(mpal_planes[0]), vld1_u8(mpal_planes[0] + 8),
+		vld1_u8(mpal_planes[0] + 16), vld1_u8(mpal_planes[0] + 24) }};
+	const uint8x8x4_t g = {{ vld1_u8(mpal_planes[1]), vld1_u8(mpal_planes[1] + 8),
+		vld1_u8(mpal_planes[1] + 16), vld1_u8(mpal_planes[1] + 24) }};
+	const uint8x8x4_t r = {{ vld1_u8(mpal_planes[2]), vld1_u8(mpal_planes[2] + 8),
+		vld1_u8(mpal_planes[2] + 16), vld1_u8(mpal_planes[2] + 24) }};
+	const uint8x8x4_t a = {{ vld1_u8(mpal_planes[3]), vld1_u8(mpal_planes[3] + 8),
+		vld1_u8(mpal_planes[3] + 16), vld1_u8(mpal_planes[3] + 24) }};
+
+	for (; n >= 8; n -= 8, src += 8, dst += 8)
+   {
+      uint8x8_t   idx = vld1_u8(src);
+      uint8x8x4_t px;
+      px.val[0] = vtbl4_u8(b, idx);
+      px.val[1] = vtbl4_u8(g, idx);
+      px.val[2] = vtbl4_u8(r, idx);
+      px.val[3] = vtbl4_u8(a, idx);
+      vst4_u8((uint8_t *)dst, px);
+   }
+#elif defined(EXPAND_SSSE3)
+	// pshufb looks up 16 entries, so colors 16..31 come from a second table
+	const __m128i b_lo = _mm_loadu_si128((const __m128i *)mpal_planes[0]);
+	const __m128i b_hi = _mm_loadu_si128((const __m128i *)(mpal_planes[0] + 16));
+	const __m128i g_lo = _mm_loadu_si128((const __m128i *)mpal_planes[1]);
+	const __m128i g_hi = _mm_loadu_si128((const __m128i *)(mpal_planes[1] + 16));
+	const __m128i r_lo = _mm_loadu_si128((const __m128i *)mpal_planes[2]);
+	const __m128i r_hi = _mm_loadu_si128((const __m128i *)(mpal_planes[2] + 16));
+	const __m128i a_lo = _mm_loadu_si128((const __m128i *)mpal_planes[3]);
+	const __m128i a_hi = _mm_loadu_si128((const __m128i *)(mpal_planes[3] + 16));
+	const __m128i fifteen = _mm_set1_epi8(15);
+	const __m128i sixteen = _mm_set1_epi8(16);
+
+	for (; n >= 16; n -= 16, src += 16, dst += 16)
+   {
+      __m128i idx    = _mm_loadu_si128((const __m128i *)src);
+      __m128i is_hi  = _mm_cmpgt_epi8(idx, fifteen);
+      // Bit 7 set makes pshufb return zero for the other table
+      __m128i idx_lo = _mm_or_si128(idx, is_hi);
+      __m128i idx_hi = _mm_or_si128(_mm_sub_epi8(idx, sixteen),
+            _mm_cmpeq_epi8(is_hi, _mm_setzero_si128()));
+
+      __m128i pb = _mm_or_si128(_mm_shuffle_epi8(b_lo, idx_lo), _mm_shuffle_epi8(b_hi, idx_hi));
+      __m128i pg = _mm_or_si128(_mm_shuffle_epi8(g_lo, idx_lo), _mm_shuffle_epi8(g_hi, idx_hi));
+      __m128i pr = _mm_or_si128(_mm_shuffle_epi8(r_lo, idx_lo), _mm_shuffle_epi8(r_hi, idx_hi));
+      __m128i pa = _mm_or_si128(_mm_shuffle_epi8(a_lo, idx_lo), _mm_shuffle_epi8(a_hi, idx_hi));
+
+      __m128i bg_lo = _mm_unpacklo_epi8(pb, pg);
+      __m128i bg_hi = _mm_unpackhi_epi8(pb, pg);
+      __m128i ra_lo = _mm_unpacklo_epi8(pr, pa);
+      __m128i ra_hi = _mm_unpackhi_epi8(pr, pa);
+
+      _mm_storeu_si128((__m128i *)dst,      _mm_unpacklo_epi16(bg_lo, ra_lo));
+      _mm_storeu_si128((__m128i *)dst + 1,  _mm_unpackhi_epi16(bg_lo, ra_lo));
+      _mm_storeu_si128((__m128i *)dst + 2,  _mm_unpacklo_epi16(bg_hi, ra_hi));
+      _mm_storeu_si128((__m128i *)dst + 3,  _mm_unpackhi_epi16(bg_hi, ra_hi));
+   }
+#else
+	for (; n >= 8; n -= 8, src += 8, dst += 8)
+   {
+      dst[0] = mpal[src[0]];
+      dst[1] = mpal[src[1]];
+      dst[2] = mpal[src[2]];
+      dst[3] = mpal[src[3]];
+      dst[4] = mpal[src[4]];
+      dst[5] = mpal[src[5]];
+      dst[6] = mpal[src[6]];
+      dst[7] = mpal[src[7]];
+   }
+#endif
+	while (n-- > 0)
+		*dst++ = mpal[*src++];
+}
+
+
+static void expand_pixels(uint16 *dst, const uint8 *src, int n)
+{
+#if defined(EXPAND_NEON) && defined(__aarch64__)
+	const uint8x16x2_t lo = {{ vld1q_u8(mpal16_planes[0]), vld1q_u8(mpal16_planes[0] + 16) }};
+	const uint8x16x2_t hi = {{ vld1q_u8(mpal16_planes[1]), vld1q_u8(mpal16_planes[1] + 16) }};
+
+	for (; n >= 16; n -= 16, src += 16, dst += 16)
+   {
+      uint8x16_t   idx = vld1q_u8(src);
+      uint8x16x2_t px;
+      px.val[0] = vqtbl2q_u8(lo, idx);
+      px.val[1] = vqtbl2q_u8(hi, idx);
+      vst2q_u8((uint8_t *)dst, px);
+   }
+#elif defined(EXPAND_NEON)
+	const uint8x8x4_t lo = {{ vld1_u8(mpal16_planes[0]), vld1_u8(mpal16_planes[0] + 8),
+		vld1_u8(mpal16_planes[0] + 16), vld1_u8(mpal16_planes[0] + 24) }};
+	const uint8x8x4_t hi = {{ vld1_u8(mpal16_planes[1]), vld1_u8(mpal16_planes[1] + 8),
+		vld1_u8(mpal16_planes[1] + 16), vld1_u8(mpal16_planes[1] + 24) }};
+
+	for (; n >= 8; n -= 8, src += 8, dst += 8)
+   {
+      uint8x8_t   idx = vld1_u8(src);
+      uint8x8x2_t px;
+      px.val[0] = vtbl4_u8(lo, idx);
+      px.val[1] = vtbl4_u8(hi, idx);
+      vst2_u8((uint8_t *)dst, px);
+   }
+#elif defined(EXPAND_SSSE3)
+	const __m128i lo_lo = _mm_loadu_si128((const __m128i *)mpal16_planes[0]);
+	const __m128i lo_hi = _mm_loadu_si128((const __m128i *)(mpal16_planes[0] + 16));
+	const __m128i hi_lo = _mm_loadu_si128((const __m128i *)mpal16_planes[1]);
+	const __m128i hi_hi = _mm_loadu_si128((const __m128i *)(mpal16_planes[1] + 16));
+	const __m128i fifteen = _mm_set1_epi8(15);
+	const __m128i sixteen = _mm_set1_epi8(16);
+
+	for (; n >= 16; n -= 16, src += 16, dst += 16)
+   {
+      __m128i idx    = _mm_loadu_si128((const __m128i *)src);
+      __m128i is_hi  = _mm_cmpgt_epi8(idx, fifteen);
+      __m128i idx_lo = _mm_or_si128(idx, is_hi);
+      __m128i idx_hi = _mm_or_si128(_mm_sub_epi8(idx, sixteen),
+            _mm_cmpeq_epi8(is_hi, _mm_setzero_si128()));
+
+      __m128i pl = _mm_or_si128(_mm_shuffle_epi8(lo_lo, idx_lo), _mm_shuffle_epi8(lo_hi, idx_hi));
+      __m128i ph = _mm_or_si128(_mm_shuffle_epi8(hi_lo, idx_lo), _mm_shuffle_epi8(hi_hi, idx_hi));
+
+      _mm_storeu_si128((__m128i *)dst,     _mm_unpacklo_epi8(pl, ph));
+      _mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi8(pl, ph));
+   }
+#else
+	for (; n >= 8; n -= 8, src += 8, dst += 8)
+   {
+      dst[0] = mpal16[src[0]];
+      dst[1] = mpal16[src[1]];
+      dst[2] = mpal16[src[2]];
+      dst[3] = mpal16[src[3]];
+      dst[4] = mpal16[src[4]];
+      dst[5] = mpal16[src[5]];
+      dst[6] = mpal16[src[6]];
+      dst[7] = mpal16[src[7]];
+   }
+#endif
+	while (n-- > 0)
+		*dst++ = mpal16[*src++];
+}
+
+
+/*
+ *  Blit the chunky C64 screen to the output through the scaler tables,
+ *  T is the output pixel type and pal the matching palette
+ */
+
+template <typename T>
+static inline void convert_line(T *dst_line, const uint8 *src_line, const T *pal)
+{
+	if (scale_x_identity)
+		expand_pixels(dst_line, src_line + scale_x[0], retrow);
+	else
+		for (int x = 0; x < retrow; x++)
+			dst_line[x] = pal[src_line[scale_x[x]]];
+}
+
+template <typename T>
+static int blit_screen(T *out, int pitch, const T *pal, int led_rows, const uint8 *dirty)
+{
+	const uint8 *pin = (const uint8 *)screen->pixels;
+	int y, changed = 0;
+
+	// Rows above the picture are not blitted, keep them black
+	if (frame_full)
+		for (y = 0; y < led_rows; y++)
+			memset(out + y * pitch, 0, retrow * sizeof(T));
+	out += led_rows * pitch;
+
+	// Copy the changed lines with overscan cropping and scaling to fill screen
+	for (y = 0; y < retroh - led_rows; y++)
+   {
+      if (!dirty[scale_y[y] / DISPLAY_X])
+         continue;
+      convert_line(out + y * pitch, pin + scale_y[y], pal);
+      changed++;
+   }
+	return changed;
+}
+
+
+/*
+ *  Decide how the lines of the coming frame are converted, done before
+ *  the VIC hands over the first line
+ */
+
+static void begin_frame(C64 *the_c64, uint8 *line_dirty)
+{
+	int led_rows = ThePrefs.ShowLEDs ? 0 : 8;
+
+	// Lines the VIC did not change are still in the output buffer from
+	// the last frame, unless it is the frontend's or something else
+	// was drawn into it
+	frame_full = (Retro_Output != valid_output || Retro_OutputPitch != valid_pitch
+			|| led_rows != valid_led_rows);
+#ifdef FRODO_SC
+	frame_full  = true;		// The cycle based VIC does not track changed lines
+	frame_fused = false;
+#else
+#ifdef FRODO_HYBRID
+	if (the_c64->SCActive)
+	{
+		frame_full  = true;	// Same for the Frodo SC chips of the hybrid engine
+		frame_fused = false;
+	}
+	else
+#endif
+	frame_fused = scale_y_identity;
+#endif
+	if (frame_full)
+		memset(line_dirty, 1, DISPLAY_Y + 16);
+
+	frame_led_y0 = frame_led_y1 = 0;
+	if (ThePrefs.ShowLEDs)
+   {
+      frame_led_y0 = DISPLAY_Y - overscan_led_bar_y;
+      frame_led_y1 = frame_led_y0 + overscan_led_bar_h;
+   }
+
+	frame_changed = 0;
+	frame_begun   = true;
+}
+
+
+/*
+ *  The VIC finished a chunky line, convert it while it is still in the
+ *  cache instead of in a second pass over the frame in Update()
+ *  (unscaled output lines only)
+ */
+
+void C64Display::ConvertLine(int line)
+{
+	int led_rows = ThePrefs.ShowLEDs ? 0 : 8;
+	int y;
+
+	if (!frame_begun)
+		begin_frame(TheC64, line_dirty);
+
+	if (!frame_fused || !line_dirty[line] || (line >= frame_led_y0 && line < frame_led_y1))
+		return;
+
+	y = line - scale_src_y;
+	if (y < 0 || y >= retroh - led_rows)
+		return;
+	y += led_rows;
+
+	const uint8 *src_line = (const uint8 *)screen->pixels + line * DISPLAY_X;
+	if (Retro_Output565)
+		convert_line((uint16 *)Retro_Output + y * Retro_OutputPitch, src_line, mpal16);
+	else
+		convert_line((uint32 *)Retro_Output + y * Retro_OutputPitch, src_line, (const uint32 *)mpal);
+
+	line_dirty[line] = 0;
+	frame_changed++;
+}
+
+
 /*
  *  Redraw bitmap
  */
 
 void C64Display::Update(void)
 {
-	int x;
-   unsigned int *pout = NULL;
-   unsigned char *pin = NULL;
+   int led_rows = ThePrefs.ShowLEDs ? 0 : 8;
+   int changed;
+   bool persistent;
+
+   if (!frame_begun)
+      begin_frame(TheC64, line_dirty);
+#if defined(SF2000)
+   static short drawn_shiftstate = -1, drawn_joystickport = -1;
+#endif
 
    if(ThePrefs.ShowLEDs)
    {
@@ -592,47 +994,50 @@ void C64Display::Update(void)
       draw_string(screen, DISPLAY_X * 2/6 + 25, DISPLAY_Y + yTPos - overscan_led_bar_y, "D\x12" "9", black, fill_gray);
       draw_string(screen, DISPLAY_X * 3/6 + 25, DISPLAY_Y + yTPos - overscan_led_bar_y, "D\x12" "10", black, fill_gray);
       draw_string(screen, DISPLAY_X * 4/6 + 25, DISPLAY_Y + yTPos - overscan_led_bar_y, "D\x12" "11", black, fill_gray);
+
+      // Convert the LED bar lines again when the LEDs changed
+      bool leds_changed = memcmp(led_state, old_led_state, sizeof(led_state)) != 0;
+#if defined(SF2000)
+      leds_changed |= (shiftstate != drawn_shiftstate || joystickport != drawn_joystickport);
+      drawn_shiftstate   = shiftstate;
+      drawn_joystickport = joystickport;
+#endif
+      if (leds_changed)
+      {
+         int y0 = DISPLAY_Y - overscan_led_bar_y;
+         for (int y = y0; y < y0 + overscan_led_bar_h; y++)
+            if (y >= 0 && y < (int)sizeof(line_dirty))
+               line_dirty[y] = 1;
+         memcpy(old_led_state, led_state, sizeof(led_state));
+      }
    }
 
-	// Update display
+	// Update display, the lines ConvertLine() did not take care of
 	//blit c64 scr 1bit depth to emu scr 4bit depth with overscan cropping
-	pout = (unsigned int *)Retro_Screen+((ThePrefs.ShowLEDs?0:8)*retrow);
-	pin  = (unsigned char *)screen->pixels;
+	if (Retro_Output565)
+		changed = blit_screen<uint16>((uint16 *)Retro_Output, Retro_OutputPitch, mpal16, led_rows, line_dirty);
+	else
+		changed = blit_screen<uint32>((uint32 *)Retro_Output, Retro_OutputPitch, (const uint32 *)mpal, led_rows, line_dirty);
+	Display_ChangedLines = frame_changed + changed;
+	memset(line_dirty, 0, sizeof(line_dirty));
+	frame_begun = false;
 
-	// Apply overscan cropping
-	int src_x = overscan_crop_left;
-	int src_y = overscan_crop_top;
-	int src_w = screen->w - overscan_crop_left - overscan_crop_right;
-	int src_h = screen->h - overscan_crop_top - overscan_crop_bottom;
-	
-	// Bounds checking
-	if (src_x < 0) src_x = 0;
-	if (src_y < 0) src_y = 0;
-	if (src_x + src_w > screen->w) src_w = screen->w - src_x;
-	if (src_y + src_h > screen->h) src_h = screen->h - src_y;
-	if (src_w <= 0) src_w = screen->w;
-	if (src_h <= 0) src_h = screen->h;
-
-	// Copy with overscan cropping and scaling to fill screen
-	for (int dst_y = 0; dst_y < retroh; dst_y++) {
-		// Map destination Y to source Y with scaling
-		int src_line_y = (dst_y * src_h) / retroh;
-		if (src_line_y >= src_h) src_line_y = src_h - 1;
-		
-		unsigned char *src_line = (unsigned char *)screen->pixels + ((src_y + src_line_y) * screen->w) + src_x;
-		unsigned int *dst_line = pout + (dst_y * retrow);
-		
-		for (int dst_x = 0; dst_x < retrow; dst_x++) {
-			// Map destination X to source X with scaling
-			int src_x_offset = (dst_x * src_w) / retrow;
-			if (src_x_offset >= src_w) src_x_offset = src_w - 1;
-			
-			*dst_line++ = mpal[src_line[src_x_offset]];
-		}
-	}
+#ifndef RENDER16B
+	persistent = (Retro_Output == Retro_Screen || Retro_Output == Retro_Screen16);
+#else
+	persistent = (Retro_Output == Retro_Screen);
+#endif
+
+	valid_output   = persistent ? Retro_Output : NULL;
+	valid_pitch    = Retro_OutputPitch;
+	valid_led_rows = led_rows;
 
 	if (SHOWKEY==1)
-      virtual_kdb(( char *)Retro_Screen,vkx,vky);
+   {
+      virtual_kdb(( char *)Retro_Output,vkx,vky);
+      valid_output         = NULL;
+      Display_ChangedLines = retroh;
+   }
 }
 
 /* Return pointer to bitmap data */
@@ -1096,6 +1501,22 @@ void C64Display::InitColors(uint8 *colors)
 	palette[green].g       = 0xf0;
    palette[green].b       = 0;
 
+	for (i = 0; i < 32; i++)
+   {
+      unsigned int c = (i < PALETTE_SIZE) ? mpal[i] : 0;
+      mpal_planes[0][i] = c & 0xff;
+      mpal_planes[1][i] = (c >> 8) & 0xff;
+      mpal_planes[2][i] = (c >> 16) & 0xff;
+      mpal_planes[3][i] = (c >> 24) & 0xff;
+
+      if (i < PALETTE_SIZE)
+         mpal16[i] = ((c >> 8) & 0xf800) | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f);
+      mpal16_planes[0][i] = (i < PALETTE_SIZE) ? (mpal16[i] & 0xff) : 0;
+      mpal16_planes[1][i] = (i < PALETTE_SIZE) ? (mpal16[i] >> 8) : 0;
+   }
+
 	for (i = 0; i < 256; i++)
 		colors[i] = i & 0x0f;
+
+	Display_InvalidateOutput();
 }
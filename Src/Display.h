@@ -45,6 +45,7 @@ class C64Display
       ~C64Display();
 
       void Update(void);
+      void ConvertLine(int line);
       void UpdateLEDs(int l0, int l1, int l2, int l3);
       uint8 *BitmapBase(void);
       int BitmapXMod(void);
@@ -62,11 +63,24 @@ class C64Display
 
       bool quit_requested;
 
+      uint8 line_dirty[DISPLAY_Y + 16];	// Set by the VIC for chunky lines that changed since the last Update()
+
    private:
       int led_state[4];
       int old_led_state[4];
+      uint8 *bitmap;			// Own bitmap of the headless display (Display_Headless.cpp)
 };
 
+// Rebuild the output scaler after overscan/resolution changes
+extern void Display_UpdateScaler(void);
+
+// Convert all lines in the next Update(), for when something else
+// was drawn into the output buffer
+extern void Display_InvalidateOutput(void);
+
+// Output lines converted by the last Update(), 0 if the frame is a dupe
+extern int Display_ChangedLines;
+
 // Manual autoload coordination variables - shared between Display.cpp and core-mapper.cpp
 extern bool any_autoload_in_progress;
 extern bool manual_autoload_triggered;
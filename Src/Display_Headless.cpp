@@ -0,0 +1,156 @@
+/*
+ *  Display_Headless.cpp - C64 graphics display without a window,
+ *                         for the batch runner
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Notes:
+ * ------
+ *
+ *  - This is linked instead of Display.cpp. Every C64Display has its
+ *    own bitmap and no other state, so each C64 of the batch runner
+ *    can run in its own thread.
+ *  - Nothing is shown and no keys are pressed, Batch.cpp types into
+ *    the keyboard buffer of the C64 directly.
+ */
+
+#include <string.h>
+
+#include "sysdeps.h"
+
+#include "Display.h"
+#include "C64.h"
+
+
+/*
+ *  Display constructor: Allocate the bitmap
+ */
+
+C64Display::C64Display(C64 *the_c64) : TheC64(the_c64)
+{
+	int i;
+
+	quit_requested = false;
+	for (i = 0; i < 4; i++)
+		led_state[i] = old_led_state[i] = 0;
+	memset(line_dirty, 0, sizeof(line_dirty));
+
+	bitmap = new uint8[DISPLAY_X * (DISPLAY_Y + 16)];
+	memset(bitmap, 0, DISPLAY_X * (DISPLAY_Y + 16));
+}
+
+
+/*
+ *  Display destructor
+ */
+
+C64Display::~C64Display()
+{
+	delete[] bitmap;
+}
+
+
+/*
+ *  Prefs may have changed
+ */
+
+void C64Display::NewPrefs(Prefs *prefs)
+{
+}
+
+
+/*
+ *  Redraw bitmap, the lines are only marked as seen
+ */
+
+void C64Display::Update(void)
+{
+	memset(line_dirty, 0, sizeof(line_dirty));
+}
+
+void C64Display::ConvertLine(int line)
+{
+}
+
+
+/*
+ *  There is no converted output that could be out of date
+ */
+
+void Display_InvalidateOutput(void)
+{
+}
+
+
+/*
+ *  Drive LEDs
+ */
+
+void C64Display::UpdateLEDs(int l0, int l1, int l2, int l3)
+{
+	led_state[0] = l0;
+	led_state[1] = l1;
+	led_state[2] = l2;
+	led_state[3] = l3;
+}
+
+
+/*
+ *  Return pointer to bitmap data and number of bytes per row
+ */
+
+uint8 *C64Display::BitmapBase(void)
+{
+	return bitmap;
+}
+
+int C64Display::BitmapXMod(void)
+{
+	return DISPLAY_X;
+}
+
+
+/*
+ *  No keyboard, no joystick keys
+ */
+
+void C64Display::PollKeyboard(uint8 *key_matrix, uint8 *rev_matrix, uint8 *joystick)
+{
+}
+
+bool C64Display::NumLock(void)
+{
+	return false;
+}
+
+void C64Display::ResetAutostart(void)
+{
+}
+
+
+/*
+ *  The bitmap holds color numbers, there is no palette to set up
+ */
+
+void C64Display::InitColors(uint8 *colors)
+{
+	int i;
+	for (i=0; i<256; i++)
+		colors[i] = i & 0x0f;
+}
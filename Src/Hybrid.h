@@ -0,0 +1,67 @@
+/*
+ *  Hybrid.h - Frodo SC chips for the hybrid engine
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Notes:
+ * ------
+ *
+ *  - With FRODO_HYBRID, the line-based chips (CPUC64.cpp, VIC.cpp,
+ *    CIA.cpp, CPU1541.cpp) and the cycle-exact ones of Frodo SC are
+ *    linked into the same binary. The *_Hybrid.cpp files compile the
+ *    Frodo SC sources a second time after including this header,
+ *    which renames the chip classes so they don't clash.
+ *  - C64, the SID, IEC, REU, 1541 job loop, display and preferences
+ *    exist only once and are shared by both sets of chips. Their
+ *    headers are included here, before the renaming, so they keep
+ *    referring to the line-based classes.
+ *  - The state structures (MOS6510State etc.) are not renamed, they
+ *    are the same for both engines. C64 hands them over at frame
+ *    boundaries to switch engines, see C64_Hybrid.cpp.
+ */
+
+#ifndef _HYBRID_H
+#define _HYBRID_H
+
+#ifndef FRODO_SC
+#define FRODO_SC
+#endif
+
+#include "sysdeps.h"
+
+#include "C64.h"
+#include "SID.h"
+#include "REU.h"
+#include "IEC.h"
+#include "1541job.h"
+#include "Display.h"
+#include "Prefs.h"
+
+#define MOS6510			MOS6510_SC
+#define MOS6569			MOS6569_SC
+#define MOS6526			MOS6526_SC
+#define MOS6526_1		MOS6526_1_SC
+#define MOS6526_2		MOS6526_2_SC
+#define MOS6502_1541	MOS6502_1541_SC
+
+// Globals of VIC_SC.cpp that VIC.cpp also has
+#define ExpTable		ExpTable_SC
+#define MultiExpTable	MultiExpTable_SC
+
+#endif
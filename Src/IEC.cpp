@@ -51,6 +51,7 @@
 #include "1541t64.h"
 #include "Prefs.h"
 #include "Display.h"
+#include "C64.h"
 #include "main.h"
 
 /* IEC command codes */
@@ -99,7 +100,7 @@ Drive *IEC::create_drive(const char *path)
    return NULL;
 }
 
-IEC::IEC(C64Display *display) : the_display(display)
+IEC::IEC(C64 *c64) : TheC64(c64), the_display(c64->TheDisplay)
 {
 	int i;
 	/* Create drives 8..11 */
@@ -108,10 +109,10 @@ IEC::IEC(C64Display *display) : the_display(display)
                            is called from the drive
                            constructors (via set_error) */
 
-	if (!ThePrefs.Emul1541Proc)
+	if (!TheC64->MachinePrefs->Emul1541Proc)
    {
       for (i=0; i<4; i++)
-         drive[i] = create_drive(ThePrefs.DrivePath[i]);
+         drive[i] = create_drive(TheC64->MachinePrefs->DrivePath[i]);
    }
 
 	listener_active = false;
@@ -146,8 +147,8 @@ void IEC::Reset(void)
 
 /*
  *  Preferences have changed, prefs points to new preferences,
- *  ThePrefs still holds the previous ones. Check if drive settings
- *  have changed.
+ *  the MachinePrefs of the C64 still hold the previous ones. Check
+ *  if drive settings have changed.
  */
 
 void IEC::NewPrefs(Prefs *prefs)
@@ -156,9 +157,9 @@ void IEC::NewPrefs(Prefs *prefs)
 	/* Delete and recreate all changed drives */
 	for (i=0; i<4; i++)
    {
-      if (     strcmp(ThePrefs.DrivePath[i],
+      if (     strcmp(TheC64->MachinePrefs->DrivePath[i],
                prefs->DrivePath[i]) 
-            || ThePrefs.Emul1541Proc != prefs->Emul1541Proc)
+            || TheC64->MachinePrefs->Emul1541Proc != prefs->Emul1541Proc)
       {
          delete drive[i];
          drive[i] = NULL;	/* Important because UpdateLEDs 
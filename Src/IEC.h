@@ -129,13 +129,14 @@ struct c64_dir_entry {
 };
 
 class Drive;
+class C64;
 class C64Display;
 class Prefs;
 
 // Class for complete IEC bus system with drives 8..11
 class IEC {
 public:
-	IEC(C64Display *display);
+	IEC(C64 *c64);
 	~IEC();
 
 	void Reset(void);
@@ -151,6 +152,8 @@ public:
 	void Turnaround(void);
 	void Release(void);
 
+	C64 *TheC64;			// Pointer to C64 object (for preferences and 1541 ROM)
+
 private:
 	Drive *create_drive(const char *path);
 
@@ -230,7 +233,6 @@ protected:
 	uint8 cmd_buf[64];		// Buffer for incoming command strings
 	int cmd_len;			// Length of received command
 
-private:
 	IEC *the_iec;			// Pointer to IEC object
 };
 
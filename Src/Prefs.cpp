@@ -55,7 +55,18 @@ Prefs::Prefs()
    strcpy(ViewPort, "Default");
    strcpy(DisplayMode, "Default");
 
+#ifdef SF2000_FAST_SID
+   SIDType            = SIDTYPE_FAST;
+#else
    SIDType            = SIDTYPE_DIGITAL;
+#endif
+#if !defined(SF2000)
+   SampleRate         = 44100;
+#else
+   SampleRate         = 22050;
+#endif
+   SID2Address        = 0;
+   SID3Address        = 0;
    REUSize            = REU_NONE;
    DisplayType        = DISPTYPE_WINDOW;
    Joystick1Port      = 0;
@@ -70,6 +81,7 @@ Prefs::Prefs()
    MapSlash           = true;
    Emul1541Proc       = true;
    SIDFilters         = true;
+   SIDThread          = false;
    DoubleScan         = true;
    HideCursor         = false;
    DirectSound        = true;	
@@ -107,6 +119,9 @@ bool Prefs::operator==(const Prefs &rhs) const
 		&& strcmp(ViewPort, rhs.ViewPort) == 0
 		&& strcmp(DisplayMode, rhs.DisplayMode) == 0
 		&& SIDType == rhs.SIDType
+		&& SampleRate == rhs.SampleRate
+		&& SID2Address == rhs.SID2Address
+		&& SID3Address == rhs.SID3Address
 		&& REUSize == rhs.REUSize
 		&& DisplayType == rhs.DisplayType
 		&& SpritesOn == rhs.SpritesOn
@@ -120,6 +135,7 @@ bool Prefs::operator==(const Prefs &rhs) const
 		&& MapSlash == rhs.MapSlash
 		&& Emul1541Proc == rhs.Emul1541Proc
 		&& SIDFilters == rhs.SIDFilters
+		&& SIDThread == rhs.SIDThread
 		&& DoubleScan == rhs.DoubleScan
 		&& HideCursor == rhs.HideCursor
 		&& DirectSound == rhs.DirectSound
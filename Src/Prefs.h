@@ -26,7 +26,9 @@
 enum {
 	SIDTYPE_NONE,		// SID emulation off
 	SIDTYPE_DIGITAL,	// Digital SID emulation
-	SIDTYPE_SIDCARD		// SID card
+	SIDTYPE_SIDCARD,	// SID card
+	SIDTYPE_FAST,		// Fast SID emulation at the output rate
+	SIDTYPE_ACCURATE	// Digital SID emulation, oversampled
 };
 
 
@@ -66,6 +68,9 @@ public:
 	char DisplayMode[256];	// Video mode to use for full screen (Win32)
 
 	int SIDType;			// SID emulation type
+	int SampleRate;			// Sound output sample rate in Hz
+	int SID2Address;		// I/O address of the second SID (0 = none)
+	int SID3Address;		// I/O address of the third SID (0 = none)
 	int REUSize;			// Size of REU
 	int DisplayType;		// Display type (BeOS)
 	int Joystick1Port;		// Port that joystick 1 is connected to (0 = no joystick, all other values are system dependant)
@@ -85,6 +90,7 @@ public:
 	bool MapSlash;			// Map '/' in C64 filenames
 	bool Emul1541Proc;		// Enable processor-level 1541 emulation
 	bool SIDFilters;		// Emulate SID filters
+	bool SIDThread;			// Calculate SID sound in a worker thread (HAVE_THREADS)
 	bool DoubleScan;		// Double scan lines (BeOS, if DisplayType == DISPTYPE_SCREEN)
 	bool JoystickGeekPort;	// Enable GeekPort joystick adapter
 	bool HideCursor;		// Hide mouse cursor when visible (Win32)
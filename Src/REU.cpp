@@ -38,7 +38,7 @@
  *  Constructor
  */
 
-REU::REU(MOS6510 *CPU) : the_cpu(CPU)
+REU::REU(MOS6510 *CPU, Prefs *prefs) : the_cpu(CPU), the_prefs(prefs)
 {
    int i;
 
@@ -52,9 +52,10 @@ REU::REU(MOS6510 *CPU) : the_cpu(CPU)
    ex_ram   = NULL;
    ram_size = 0;
    ram_mask = 0;
+   rand_seed = 1;
 
    // Allocate RAM
-   open_close_reu(REU_NONE, ThePrefs.REUSize);
+   open_close_reu(REU_NONE, the_prefs->REUSize);
 }
 
 
@@ -65,7 +66,7 @@ REU::REU(MOS6510 *CPU) : the_cpu(CPU)
 REU::~REU()
 {
 	// Free RAM
-	open_close_reu(ThePrefs.REUSize, REU_NONE);
+	open_close_reu(the_prefs->REUSize, REU_NONE);
 }
 
 
@@ -75,7 +76,7 @@ REU::~REU()
 
 void REU::NewPrefs(Prefs *prefs)
 {
-	open_close_reu(ThePrefs.REUSize, prefs->REUSize);
+	open_close_reu(the_prefs->REUSize, prefs->REUSize);
 }
 
 
@@ -149,7 +150,10 @@ void REU::Reset(void)
 uint8 REU::ReadRegister(uint16 adr)
 {
 	if (!ex_ram)
-		return rand();
+	{
+		rand_seed = rand_seed * 1103515245 + 12345;
+		return rand_seed >> 16;
+	}
 
 	switch (adr)
    {
@@ -27,7 +27,7 @@ class Prefs;
 
 class REU {
 public:
-	REU(MOS6510 *CPU);
+	REU(MOS6510 *CPU, Prefs *prefs);
 	~REU();
 
 	void NewPrefs(Prefs *prefs);
@@ -41,6 +41,7 @@ private:
 	void execute_dma(void);
 
 	MOS6510 *the_cpu;	// Pointer to 6510
+	Prefs *the_prefs;	// Pointer to preferences
 
 	uint8 *ex_ram;		// REU expansion RAM
 
@@ -48,6 +49,7 @@ private:
 	uint32 ram_mask;		// Expansion RAM address bit mask
 
 	uint8 regs[16];		// REU registers
+	uint32 rand_seed;	// Random numbers for open I/O without an REU
 };
 
 #endif
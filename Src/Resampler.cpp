@@ -0,0 +1,202 @@
+/*
+ *  Resampler.cpp - Sample rate conversion of the sound output
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Notes:
+ * ------
+ *
+ *  - Polyphase FIR filter: Every output sample is the sum of
+ *    RESAMPLER_TAPS input samples, weighted with the windowed sinc
+ *    table of the phase (sub-sample position) it falls on. Only the
+ *    tables are calculated in floating point, when the rates change.
+ *  - The position is kept as an exact fraction of in_rate/out_rate,
+ *    so the resampler consumes exactly in_rate samples for every
+ *    out_rate samples it produces, however long it runs.
+ *  - The caller asks InputBuffer() how many input samples the next
+ *    Process() call needs and writes them there. The filter delays
+ *    the signal by RESAMPLER_TAPS/2 input samples, the input never
+ *    runs ahead of the output.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "sysdeps.h"
+
+#include "Resampler.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Cutoff frequency, relative to the Nyquist frequency of the lower rate
+const double RESAMPLER_CUTOFF = 0.9;
+
+
+/*
+ *  Constructor
+ */
+
+Resampler::Resampler()
+{
+	buf       = NULL;
+	buf_size  = 0;
+	buf_count = 0;
+	in_rate   = out_rate = 0;
+	SetRates(44100, 44100);
+}
+
+
+/*
+ *  Destructor
+ */
+
+Resampler::~Resampler()
+{
+	delete[] buf;
+}
+
+
+/*
+ *  Set input and output sample rate, calculate the filter tables
+ */
+
+void Resampler::SetRates(uint32 in, uint32 out)
+{
+	int p, t;
+
+	if (in == in_rate && out == out_rate)
+		return;
+	in_rate  = in;
+	out_rate = out;
+	phase_scale = (uint32)(((uint64)RESAMPLER_PHASES << 32) / out_rate);
+
+	// Windowed sinc, normalized to a DC gain of 1 for each phase
+	double fc = RESAMPLER_CUTOFF * (out_rate < in_rate ? (double)out_rate / in_rate : 1.0);
+	for (p = 0; p < RESAMPLER_PHASES; p++)
+	{
+		double c[RESAMPLER_TAPS];
+		double sum = 0.0;
+		int total  = 0;
+
+		for (t = 0; t < RESAMPLER_TAPS; t++)
+		{
+			// Distance of the tap from the output sample
+			double x = t - (RESAMPLER_TAPS/2 - 1) - (double)p / RESAMPLER_PHASES;
+			double w = 0.42 + 0.5 * cos(2 * M_PI * x / RESAMPLER_TAPS) + 0.08 * cos(4 * M_PI * x / RESAMPLER_TAPS);
+			double s = x == 0.0 ? fc : sin(M_PI * fc * x) / (M_PI * x);
+			c[t] = s * w;
+			sum += c[t];
+		}
+		for (t = 0; t < RESAMPLER_TAPS; t++)
+		{
+			coef[p][t] = (int16)floor(c[t] / sum * 16384.0 + 0.5);
+			total += coef[p][t];
+		}
+
+		// Put the rounding error on the largest tap
+		coef[p][RESAMPLER_TAPS/2 - 1 + (p >= RESAMPLER_PHASES/2)] += 16384 - total;
+	}
+
+	// Start with silence
+	delete[] buf;
+	buf_size  = RESAMPLER_TAPS * 2;
+	buf       = new int16[buf_size];
+	buf_count = RESAMPLER_TAPS - 1;
+	memset(buf, 0, buf_size * sizeof(int16));
+	pos_frac  = 0;
+}
+
+
+/*
+ *  Get the buffer for the input samples of the next Process() call,
+ *  in_count is set to the number of samples to write there
+ */
+
+int16 *Resampler::InputBuffer(int out_count, int &in_count)
+{
+	// An empty frame needs nothing, the position below would wrap
+	if (out_count <= 0)
+	{
+		in_count = 0;
+		return buf + buf_count;
+	}
+
+	// Position of the last output sample, and input samples it needs
+	uint64 last = pos_frac + (uint64)(out_count - 1) * in_rate;
+	int needed  = (int)(last / out_rate) + RESAMPLER_TAPS;
+
+	if (needed > buf_size)
+	{
+		int16 *new_buf = new int16[needed];
+		memcpy(new_buf, buf, buf_count * sizeof(int16));
+		delete[] buf;
+		buf      = new_buf;
+		buf_size = needed;
+	}
+
+	in_count  = needed > buf_count ? needed - buf_count : 0;
+	int16 *in = buf + buf_count;
+	buf_count += in_count;
+	return in;
+}
+
+
+/*
+ *  Calculate output samples, the input must have been written
+ *  to InputBuffer() before
+ */
+
+void Resampler::Process(int16 *out, int out_count)
+{
+	uint32 step     = in_rate / out_rate;
+	uint32 step_rem = in_rate % out_rate;
+	uint32 frac     = pos_frac;
+	int16 *in       = buf;
+
+	while (out_count--)
+	{
+		const int16 *c = coef[(uint32)(((uint64)frac * phase_scale) >> 32)];
+		int32 sum = 0;
+		for (int t = 0; t < RESAMPLER_TAPS; t++)
+			sum += in[t] * c[t];
+
+		sum = (sum + 0x2000) >> 14;
+		if (sum > 32767)
+			sum = 32767;
+		else if (sum < -32768)
+			sum = -32768;
+		*out++ = sum;
+
+		in   += step;
+		frac += step_rem;
+		if (frac >= out_rate)
+		{
+			frac -= out_rate;
+			in++;
+		}
+	}
+
+	// Drop the input samples that are no longer needed
+	int used   = in - buf;
+	buf_count -= used;
+	memmove(buf, in, buf_count * sizeof(int16));
+	pos_frac   = frac;
+}
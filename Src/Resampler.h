@@ -0,0 +1,50 @@
+/*
+ *  Resampler.h - Sample rate conversion of the sound output
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _RESAMPLER_H
+#define _RESAMPLER_H
+
+
+const int RESAMPLER_TAPS = 16;		// Filter length in input samples
+const int RESAMPLER_PHASES = 256;	// Number of sub-sample positions
+
+class Resampler {
+public:
+	Resampler();
+	~Resampler();
+
+	void SetRates(uint32 in, uint32 out);
+	int16 *InputBuffer(int out_count, int &in_count);
+	void Process(int16 *out, int out_count);
+
+private:
+	uint32 in_rate;		// Input sample rate in Hz
+	uint32 out_rate;	// Output sample rate in Hz
+	uint32 phase_scale;	// Converts pos_frac to a phase, 0.32 fixed
+
+	int16 coef[RESAMPLER_PHASES][RESAMPLER_TAPS];	// Filter for each phase, 2.14 fixed
+
+	int16 *buf;			// Input samples, the oldest one still needed first
+	int buf_size;		// Size of buf in samples
+	int buf_count;		// Number of samples in buf
+	uint32 pos_frac;	// Position of next output sample after buf[0], in 1/out_rate input samples
+};
+
+#endif
@@ -33,13 +33,9 @@
 #define MOS6569_OPTIMIZED MOS6569
 #endif
 
-#ifdef SF2000_FAST_SID
-#include "SID_SF2000.h"
-#define MOS6581_OPTIMIZED MOS6581_SF2000
-#else
+// SF2000_FAST_SID makes the fast renderer (SIDTYPE_FAST) the default SID type
 #include "SID.h"
 #define MOS6581_OPTIMIZED MOS6581
-#endif
 
 // SF2000 performance tuning constants
 #define SF2000_CPU_CYCLES_PER_FRAME    65000   // Restored to ~65000 for full emulation
@@ -96,11 +92,7 @@
 #endif
 
 // SID optimization macros
-#ifdef SF2000_FAST_SID
-#define FAST_SID_GENERATE_SAMPLES(buf, num) GenerateSamples((int16*)buf, num)
-#else
 #define FAST_SID_GENERATE_SAMPLES(buf, num) EmulateLine()
-#endif
 
 // Compiler hints for SF2000 MIPS
 #ifdef SF2000_MIPS_OPTIMIZED
@@ -19,6 +19,56 @@
  */
 
 /*
+ * Notes:
+ * ------
+ *
+ *  - The digital renderer doesn't apply register writes right away.
+ *    They are queued with the cycle at which they happened and
+ *    calc_buffer() applies them at the matching sample, calculating
+ *    the samples between two writes in one go. With the line-based
+ *    chips, CycleCounter doesn't advance, so all writes of a raster
+ *    line are applied at its start.
+ *  - The C64 class counts the output samples of each raster line, with
+ *    the fraction carried over to the next line, the same for all
+ *    SIDs. VBlank() calculates exactly the samples of the frame that
+ *    ended, so the frontend plays them right after the frame.
+ *  - The digital renderer calculates the samples at synth_freq, where
+ *    a sample is a whole number of SID clocks. The Resampler converts
+ *    them to the output rate set in the prefs. SIDTYPE_ACCURATE is the
+ *    same renderer with half as many SID clocks per sample.
+ *  - The filter coefficients for all types, resonances and cutoff
+ *    frequencies are calculated in Q15 fixed point when the first
+ *    renderer with a synth_freq is created. All renderers with that
+ *    rate share the table until the program exits. Renderers are only
+ *    created with the C64 (one at a time in Batch) or when the SID type
+ *    changes in the prefs, so building it on first use needs no lock.
+ *    The filter itself only uses integer math, which keeps filter
+ *    sweeps cheap on machines without an FPU.
+ *  - With HAVE_THREADS and the SIDThread prefs option, the digital
+ *    renderer calculates the sound in a worker thread. The write queue
+ *    is the only data the emulation and the worker share while a frame
+ *    is calculated: The emulation thread only moves queue_tail and the
+ *    worker only queue_head. VBlank() hands out the frame the
+ *    worker finished and starts the next one, so the sound is one
+ *    frame late. Everything else waits for the worker to be idle.
+ *  - calc_buffer() only applies the writes that were queued when
+ *    VBlank() was called (queue_end). The last sample of a frame can
+ *    lie a little past its end, and it must not see the writes of
+ *    the next frame the emulation is queueing meanwhile.
+ *    So the threaded sound is the same as without the thread, with a
+ *    frame of silence in front.
+ *  - SIDTYPE_FAST is the FastRenderer in SID_Fast.cpp. The SID type
+ *    can be switched while the emulation runs, the new renderer gets
+ *    the current register values.
+ *  - Up to two extra SIDs can be mapped into the I/O area (SID2Address
+ *    and SID3Address in the prefs). They only keep their registers
+ *    until they are first written to, and only then open a renderer,
+ *    so software that doesn't use them costs no synthesis. Mix()
+ *    puts the frames of all SIDs into SoundBuf as stereo samples in
+ *    one vectorized pass. SID2Address is always on the right and
+ *    SID3Address always in the center, an inactive extra SID leaves
+ *    its position to the main SID or silence.
+ *
  * Incompatibilities:
  * ------------------
  *
@@ -31,13 +81,37 @@
 
 #include "sysdeps.h"
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIX_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MIX_SSE2 1
+#endif
+
 #include "SID.h"
 #include "Prefs.h"
+#include "C64.h"
+#include "VIC.h"
+#include "Resampler.h"
+#include "SID_Fast.h"
+#include "TableGen.h"
 
 #ifdef USE_FIXPOINT_MATHS
 #include "FixPoint.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+
+// The write queue indices are shared with the worker thread
+#define QUEUE_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define QUEUE_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#else
+#define QUEUE_LOAD(x) (x)
+#define QUEUE_STORE(x, v) ((x) = (v))
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -63,9 +137,8 @@
  *  Random number generator for noise waveform
  */
 
-static uint8 sid_random(void)
+static inline uint8 sid_random(uint32 &seed)
 {
-	static uint32 seed = 1;
 	seed = seed * 1103515245 + 12345;
 	return seed >> 16;
 }
@@ -75,15 +148,20 @@ static uint8 sid_random(void)
  *  Constructor
  */
 
-MOS6581::MOS6581(C64 *c64) : the_c64(c64)
+MOS6581::MOS6581(C64 *c64, bool extra) : the_c64(c64)
 {
    unsigned i;
-	the_renderer = NULL;
+	the_renderer  = NULL;
+	renderer_type = SIDTYPE_NONE;
+	active        = !extra;
 	for (i=0; i < 32; i++)
 		regs[i] = 0;
+	last_sid_byte = 0;
+	rand_seed     = the_c64->Random();
 
-	// Open the renderer
-	open_close_renderer(SIDTYPE_NONE, ThePrefs.SIDType);
+	// Open the renderer, extra SIDs wait for their first write
+	if (active)
+		open_close_renderer(SIDTYPE_NONE, the_c64->MachinePrefs->SIDType);
 }
 
 
@@ -94,7 +172,7 @@ MOS6581::MOS6581(C64 *c64) : the_c64(c64)
 MOS6581::~MOS6581()
 {
 	// Close the renderer
-	open_close_renderer(ThePrefs.SIDType, SIDTYPE_NONE);
+	open_close_renderer(renderer_type, SIDTYPE_NONE);
 }
 
 
@@ -121,12 +199,116 @@ void MOS6581::Reset(void)
 
 void MOS6581::NewPrefs(Prefs *prefs)
 {
-	open_close_renderer(ThePrefs.SIDType, prefs->SIDType);
+	if (active)
+		open_close_renderer(renderer_type, prefs->SIDType);
 	if (the_renderer)
 		the_renderer->NewPrefs(prefs);
 }
 
 
+/*
+ *  Fill buffer (for Unix sound routines), sample volume (for sampled voice)
+ */
+
+void MOS6581::EmulateLine(void)
+{
+	if (the_renderer != NULL)
+		the_renderer->EmulateLine();
+}
+
+
+/*
+ *  First write to an extra SID: Open its renderer
+ */
+
+void MOS6581::activate(void)
+{
+	active = true;
+	open_close_renderer(renderer_type, the_c64->MachinePrefs->SIDType);
+}
+
+
+/*
+ *  Calculate count samples of the frame that ended into buf, switch
+ *  the renderer if the SID type was changed in the prefs directly
+ */
+
+void MOS6581::VBlank(int16 *buf, int count)
+{
+	if (the_renderer != NULL)
+		the_renderer->VBlank(buf, count);
+	else
+		memset(buf, 0, count*2);
+
+	// Between frames, so no samples get lost
+	if (active && renderer_type != the_c64->MachinePrefs->SIDType)
+		open_close_renderer(renderer_type, the_c64->MachinePrefs->SIDType);
+}
+
+
+/*
+ *  Mix the frames of up to three SIDs into count interleaved stereo
+ *  samples: sid1 left, sid2 right and sid3 centered at half volume.
+ *  sid2 and sid3 are NULL for SIDs that are missing or not active
+ *  yet. Without sid2 the right channel is sid1, without sid3 nothing
+ *  is added in the center.
+ */
+
+static inline int16 mix_clip(int32 x)
+{
+	return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+void MOS6581::Mix(int16 *out, const int16 *sid1, const int16 *sid2, const int16 *sid3, int count)
+{
+	int i = 0;
+
+#if defined(MIX_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		int16x8x2_t lr;
+		lr.val[0] = vld1q_s16(sid1 + i);
+		lr.val[1] = sid2 ? vld1q_s16(sid2 + i) : lr.val[0];
+		if (sid3)
+		{
+			int16x8_t c = vshrq_n_s16(vld1q_s16(sid3 + i), 1);
+			lr.val[0] = vqaddq_s16(lr.val[0], c);
+			lr.val[1] = vqaddq_s16(lr.val[1], c);
+		}
+		vst2q_s16(out + i*2, lr);
+	}
+#elif defined(MIX_SSE2)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i l = _mm_loadu_si128((const __m128i *)(sid1 + i));
+		__m128i r = sid2 ? _mm_loadu_si128((const __m128i *)(sid2 + i)) : l;
+		if (sid3)
+		{
+			__m128i c = _mm_srai_epi16(_mm_loadu_si128((const __m128i *)(sid3 + i)), 1);
+			l = _mm_adds_epi16(l, c);
+			r = _mm_adds_epi16(r, c);
+		}
+		_mm_storeu_si128((__m128i *)(out + i*2), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128((__m128i *)(out + i*2 + 8), _mm_unpackhi_epi16(l, r));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		int32 l = sid1[i];
+		int32 r = sid2 ? sid2[i] : l;
+		if (sid3)
+		{
+			int32 c = sid3[i] >> 1;
+			l = mix_clip(l + c);
+			r = mix_clip(r + c);
+		}
+		out[i*2]     = l;
+		out[i*2 + 1] = r;
+	}
+}
+
+
 /*
  *  Pause sound output
  */
@@ -235,18 +417,20 @@ void MOS6581::SetState(MOS6581State *ss)
 
 
 /**
- **  Renderer for digital SID emulation (SIDTYPE_DIGITAL)
+ **  Renderer for digital SID emulation (SIDTYPE_DIGITAL, SIDTYPE_ACCURATE)
  **/
 
 #if !defined(SF2000)
-const uint32 SAMPLE_FREQ = 44100;	// Sample output frequency in Hz
+const uint32 SID_CYCLES = 22;		// # of SID clocks per sample frame (44784Hz, resampled for output)
 #else
-const uint32 SAMPLE_FREQ = 22050;	// Sample output frequency in Hz
+const uint32 SID_CYCLES = 44;		// # of SID clocks per sample frame
 #endif
-const uint32 SID_FREQ = 985248;		// SID frequency in Hz
-const uint32 CALC_FREQ = 50;			// Frequency at which calc_buffer is called in Hz (should be 50Hz)
-const uint32 SID_CYCLES = SID_FREQ/SAMPLE_FREQ;	// # of SID clocks per sample frame
-const int SAMPLE_BUF_SIZE = 0x138*2;// Size of buffer for sampled voice (double buffered)
+const uint32 LINE_CYCLES = 63;		// # of C64 cycles per raster line
+const uint32 TIMELINE_FREQ = LINE_CYCLES*TOTAL_RASTERS*SCREEN_FREQ;	// # of C64 cycles per second, as counted by EmulateLine()
+const int WRITE_QUEUE_SIZE = 4096;	// Max. # of register writes waiting for calc_buffer() (power of 2)
+const int CALC_BLOCK = 64;			// # of samples calculated by each pass of calc_samples()
+const int32 SILENCE_LEVEL = 1 << 10;	// Filter state below this doesn't change the output (one LSB)
+const int32 COEF_ONE = 1 << 15;		// 1.0 in the Q15 filter coefficients
 
 // SID waveforms (some of them :-)
 enum {
@@ -282,48 +466,75 @@ enum
    FILT_ALL
 };
 
-// Structure for one voice
-struct DRVoice
+// Data for the three voices, one array element per voice, so
+// every pass of calc_samples() only touches the fields it needs
+struct DRVoices
 {
-   int wave;		// Selected waveform
-   int eg_state;	// Current state of EG
-   DRVoice *mod_by;	// Voice that modulates this one
-   DRVoice *mod_to;	// Voice that is modulated by this one
+   int wave[3];		// Selected waveform
+   int eg_state[3];	// Current state of EG
 
-   uint32 count;	// Counter for waveform generator, 8.16 fixed
-   uint32 add;		// Added to counter in every frame
+   uint32 count[3];	// Counter for waveform generator, 8.16 fixed
+   uint32 add[3];	// Added to counter in every frame
 
-   uint16 freq;		// SID frequency value
-   uint16 pw;		// SID pulse-width value
+   uint16 freq[3];	// SID frequency value
+   uint16 pw[3];	// SID pulse-width value
 
-   uint32 a_add;	// EG parameters
-   uint32 d_sub;
-   uint32 s_level;
-   uint32 r_sub;
-   uint32 eg_level;	// Current EG level, 8.16 fixed
+   uint32 a_add[3];	// EG parameters
+   uint32 d_sub[3];
+   uint32 s_level[3];
+   uint32 r_sub[3];
+   uint32 eg_level[3];	// Current EG level, 8.16 fixed
 
-   uint32 noise;	// Last noise generator output value
+   uint32 noise[3];	// Last noise generator output value
 
-   bool gate;		// EG gate bit
-   bool ring;		// Ring modulation bit
-   bool test;		// Test bit
-   bool filter;	// Flag: Voice filtered
+   bool gate[3];	// EG gate bit
+   bool ring[3];	// Ring modulation bit
+   bool test[3];	// Test bit
+   bool filter[3];	// Flag: Voice filtered
 
    // The following bit is set for the modulating
    // voice, not for the modulated one (as the SID bits)
-   bool sync;		// Sync modulation bit
-   bool mute;		// Voice muted (voice 3 only)
+   bool sync[3];	// Sync modulation bit
+   bool mute[3];	// Voice muted (voice 3 only)
+};
+
+// Voice that modulates each voice, and voice that is modulated by it
+static const int VoiceModBy[3] = {2, 0, 1};
+static const int VoiceModTo[3] = {1, 2, 0};
+
+// Register write waiting to be applied
+struct SIDWrite
+{
+   uint32 time;	// Cycle of the write
+   uint8 adr;		// Register number
+   uint8 byte;		// Written value
+};
+
+// Filter coefficients for one type/resonance/cutoff, Q15
+struct FilterCoef
+{
+   int32 ampl;	// Input attenuation
+   int32 g1;		// Poles
+   int32 g2;
+};
+
+// Filter coefficients for one synth_freq
+struct FilterTable
+{
+   FilterCoef coef[6 * 16 * 256];	// [f_type-1][f_res][f_freq]
+   int32 notch_d1[256];			// Notch filter zeros for each f_freq, Q15
 };
 
 // Renderer class
 class DigitalRenderer : public SIDRenderer
 {
    public:
-      DigitalRenderer(C64 *c64);
+      DigitalRenderer(C64 *c64, bool oversample);
       virtual ~DigitalRenderer();
 
       virtual void Reset(void);
       virtual void EmulateLine(void);
+      virtual void VBlank(int16 *buf, int count);
       virtual void WriteRegister(uint16 adr, uint8 byte);
       virtual void NewPrefs(Prefs *prefs);
       virtual void Pause(void);
@@ -331,56 +542,96 @@ class DigitalRenderer : public SIDRenderer
 
    private:
       void init_sound(void);
+      void set_output_freq(int freq);
+      void calc_frame(int16 *buf, int count);
+#ifdef HAVE_THREADS
+      void start_thread(void);
+      void stop_thread(void);
+      void wait_job(void);
+      void lead_in(void);
+      static void thread_func(void *arg);
+#endif
+      static FilterTable *calc_filter_table(uint32 synth_freq);
       void calc_filter(void);
       void calc_buffer(int16 *buf, long count);
+      void calc_samples(int16 *buf, long count);
+      bool is_silent(void);
+      void calc_envelope(int j, uint8 master_volume, uint16 *env, int n);
+      void calc_oscillators(uint32 cnt[3][CALC_BLOCK+1], uint16 noise_out[3][CALC_BLOCK], int n);
+      void calc_waveform(int j, const uint32 *cnt, const uint32 *ring_cnt, const uint16 *noise_out,
+            const uint16 *env, int32 *sum, int n);
+      void apply_write(uint16 adr, uint8 byte);
 
       C64 *the_c64;					// Pointer to C64 object
 
       bool ready;						// Flag: Renderer has initialized and is ready
       uint8 volume;					// Master volume
 
-      static uint16 TriTable[0x1000*2];	// Tables for certain waveforms
+      static const uint16 TriTable[0x1000*2];	// Tables for certain waveforms
       static const uint16 TriSawTable[0x100];
       static const uint16 TriRectTable[0x100];
       static const uint16 SawRectTable[0x100];
       static const uint16 TriSawRectTable[0x100];
-      static const uint32 EGTable[16];	// Increment/decrement values for all A/D/R settings
+      static const uint16 EGPeriod[16];	// SID clocks per envelope step for all A/D/R settings
       static const uint8 EGDRShift[256]; // For exponential approximation of D/R
       static const int16 SampleTab[16]; // Table for sampled voice
 
-      DRVoice voice[3];				// Data for 3 voices
+      uint32 synth_freq;				// Sample frequency of the voices and the filter in Hz
+      uint32 EGTable[16];				// Increment/decrement values for all A/D/R settings
+
+      DRVoices voice;					// Data for 3 voices
 
       uint8 f_type;					// Filter type
       uint8 f_freq;					// SID filter frequency (upper 8 bits)
       uint8 f_res;					// Filter resonance (0..15)
+      int32 f_ampl;					// IIR filter input attenuation, Q15
+      int32 d1, d2, g1, g2;			// IIR filter coefficients, Q15
+      int32 xn1, xn2, yn1, yn2;		// IIR filter previous input/output signal
+      const FilterTable *filter_tab;	// Filter coefficients for synth_freq
+      static FilterTable *filter_tables[2];	// Shared tables, built on first use, [oversample]
 #ifdef USE_FIXPOINT_MATHS
-      FixPoint f_ampl;
-      FixPoint d1, d2, g1, g2;
-      int32 xn1, xn2, yn1, yn2;		// can become very large
       FixPoint sidquot;
-#ifdef PRECOMPUTE_RESONANCE
-      FixPoint resonanceLP[256];
-      FixPoint resonanceHP[256];
-#endif
-#else
-      float f_ampl;					// IIR filter input attenuation
-      float d1, d2, g1, g2;			// IIR filter coefficients
-      float xn1, xn2, yn1, yn2;		// IIR filter previous input/output signal
-#ifdef PRECOMPUTE_RESONANCE
-      float resonanceLP[256];			// shortcut for calc_filter
-      float resonanceHP[256];
-#endif
 #endif
 
-      uint8 sample_buf[SAMPLE_BUF_SIZE]; // Buffer for sampled voice
-      int sample_in_ptr;				// Index in sample_buf for writing
+      SIDWrite write_queue[WRITE_QUEUE_SIZE]; // Register writes not yet applied
+      uint32 queue_head;				// Index of oldest write in write_queue
+      uint32 queue_tail;				// Index of next free entry in write_queue
+      uint32 queue_end;				// calc_buffer() only applies the writes before it
+      uint32 line_clock;				// Cycle at which the current raster line started
+      uint32 line_cycle;				// C64 CycleCounter at that time
+      uint32 sample_clock;			// Cycle of the next sample to calculate
+      uint32 sample_frac;				// Fractional part of it, in 1/synth_freq cycles
 
-      int devfd, sndbufsize, buffer_rate;
+      int devfd, sndbufsize, buffer_rate;	// sndbufsize: Samples per frame, rounded up
       int16 *sound_buffer;
+      int prefs_freq;					// SampleRate of the prefs output_freq is set from
+      uint32 output_freq;				// Output sample frequency in Hz
+      Resampler resampler;			// Converts from synth_freq to output_freq
+
+      uint32 noise_seed;				// Random number generator for noise waveform
+
+#ifdef HAVE_THREADS
+      sthread_t *thread;				// Worker thread calculating the sound, NULL if none
+      slock_t *job_lock;				// Protects job_len and job_quit
+      scond_t *job_cond;				// Signals changes of job_len and job_quit
+      int job_len;					// Samples the worker has to calculate into job_buf
+      int16 *job_buf;					// Where the worker puts them (in sound_buffer)
+      int ahead_len;					// Samples the worker calculated ahead in sound_buffer
+      bool job_quit;					// Flag: Worker thread shall exit
+#endif
 };
 
 // Static data members
-uint16 DigitalRenderer::TriTable[0x1000*2];
+FilterTable *DigitalRenderer::filter_tables[2];
+
+// Rising and falling half of the triangle wave, 12 bits scaled to 16
+#define TRI_UP(i) (((i) << 4) | ((i) >> 8))
+#define TRI_DOWN(i) TRI_UP(0xfff - ((i) - 0x1000))
+const uint16 DigitalRenderer::TriTable[0x1000*2] = {
+	TABLE_4096(TRI_UP, 0), TABLE_4096(TRI_DOWN, 0x1000)
+};
+#undef TRI_UP
+#undef TRI_DOWN
 
 #ifndef EMUL_MOS8580
 // Sampled from a 6581R4
@@ -666,15 +917,9 @@ const uint16 DigitalRenderer::TriSawRectTable[0x100] = {
 };
 #endif
 
-const uint32 DigitalRenderer::EGTable[16] = {
-	(SID_CYCLES << 16) / 9,     (SID_CYCLES << 16) / 32,
-	(SID_CYCLES << 16) / 63,    (SID_CYCLES << 16) / 95,
-	(SID_CYCLES << 16) / 149,   (SID_CYCLES << 16) / 220,
-	(SID_CYCLES << 16) / 267,   (SID_CYCLES << 16) / 313,
-	(SID_CYCLES << 16) / 392,   (SID_CYCLES << 16) / 977,
-	(SID_CYCLES << 16) / 1954,  (SID_CYCLES << 16) / 3126,
-	(SID_CYCLES << 16) / 3906,  (SID_CYCLES << 16) / 11720,
-	(SID_CYCLES << 16) / 19531, (SID_CYCLES << 16) / 31251
+const uint16 DigitalRenderer::EGPeriod[16] = {
+	9, 32, 63, 95, 149, 220, 267, 313,
+	392, 977, 1954, 3126, 3906, 11720, 19531, 31251
 };
 
 const uint8 DigitalRenderer::EGDRShift[256] = {
@@ -706,46 +951,37 @@ const int16 DigitalRenderer::SampleTab[16] = {
  *  Constructor
  */
 
-DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
+DigitalRenderer::DigitalRenderer(C64 *c64, bool oversample) : the_c64(c64)
 {
    unsigned i;
+   uint32 sid_cycles = oversample ? SID_CYCLES / 2 : SID_CYCLES;
 
-	// Link voices together
-	voice[0].mod_by = &voice[2];
-	voice[1].mod_by = &voice[0];
-	voice[2].mod_by = &voice[1];
-	voice[0].mod_to = &voice[1];
-	voice[1].mod_to = &voice[2];
-	voice[2].mod_to = &voice[0];
+#ifdef HAVE_THREADS
+	thread     = NULL;
+#endif
 
-	// Calculate triangle table
-	for (i=0; i<0x1000; i++)
-   {
-      TriTable[i]        = (i << 4) | (i >> 8);
-      TriTable[0x1fff-i] = (i << 4) | (i >> 8);
-   }
+	synth_freq = SID_FREQ / sid_cycles;
+	for (i=0; i<16; i++)
+		EGTable[i] = (sid_cycles << 16) / EGPeriod[i];
+
+	noise_seed = 1;
+
+	queue_head   = queue_tail = queue_end = 0;
+	line_clock   = 0;
+	line_cycle   = c64->CycleCounter;
+	sample_clock = 0;
+	sample_frac  = 0;
 
-#ifdef PRECOMPUTE_RESONANCE
 #ifdef USE_FIXPOINT_MATHS
-	// slow floating point doesn't matter much on startup!
-	for (i=0; i<256; i++)
-   {
-      resonanceLP[i] = FixNo(CALC_RESONANCE_LP(i));
-      resonanceHP[i] = FixNo(CALC_RESONANCE_HP(i));
-   }
 	// Pre-compute the quotient. No problem since int-part is small enough
-	sidquot = (int32)((((double)SID_FREQ)*65536) / SAMPLE_FREQ);
-	// compute lookup table for sin and cos
-	InitFixSinTab();
-#else
-	for (i=0; i<256; i++)
-   {
-      resonanceLP[i] = CALC_RESONANCE_LP(i);
-      resonanceHP[i] = CALC_RESONANCE_HP(i);
-   }
-#endif
+	sidquot = (int32)((((double)SID_FREQ)*65536) / synth_freq);
 #endif
 
+	// Filter coefficients, shared by all renderers with this synth_freq
+	if (!filter_tables[oversample])
+		filter_tables[oversample] = calc_filter_table(synth_freq);
+	filter_tab = filter_tables[oversample];
+
 	Reset();
 
 	// System specific initialization
@@ -760,160 +996,187 @@ DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
 void DigitalRenderer::Reset(void)
 {
    unsigned v;
+#ifdef HAVE_THREADS
+   wait_job();
+#endif
    volume = 0;
 
    for (v=0; v<3; v++)
    {
-      voice[v].wave     = WAVE_NONE;
-      voice[v].eg_state = EG_IDLE;
-      voice[v].count    = 0;
-      voice[v].add      = 0;
-      voice[v].freq     = 0;
-      voice[v].pw       = 0;
-      voice[v].eg_level = 0;
-      voice[v].s_level  = 0;
-      voice[v].a_add    = EGTable[0];
-      voice[v].d_sub    = EGTable[0];
-      voice[v].r_sub    = EGTable[0];
-      voice[v].gate     = false;
-      voice[v].ring     = false;
-      voice[v].test     = false;
-      voice[v].filter   = false;
-      voice[v].sync     = false;
-      voice[v].mute     = false;
+      voice.wave[v]     = WAVE_NONE;
+      voice.eg_state[v] = EG_IDLE;
+      voice.count[v]    = 0;
+      voice.add[v]      = 0;
+      voice.freq[v]     = 0;
+      voice.pw[v]       = 0;
+      voice.eg_level[v] = 0;
+      voice.s_level[v]  = 0;
+      voice.noise[v]    = 0;
+      voice.a_add[v]    = EGTable[0];
+      voice.d_sub[v]    = EGTable[0];
+      voice.r_sub[v]    = EGTable[0];
+      voice.gate[v]     = false;
+      voice.ring[v]     = false;
+      voice.test[v]     = false;
+      voice.filter[v]   = false;
+      voice.sync[v]     = false;
+      voice.mute[v]     = false;
    }
 
    f_type = FILT_NONE;
    f_freq = f_res = 0;
-#ifdef USE_FIXPOINT_MATHS
-   f_ampl = FixNo(1);
+   f_ampl = COEF_ONE;
    d1 = d2 = g1 = g2 = 0;
    xn1 = xn2 = yn1 = yn2 = 0;
-#else
-   f_ampl = 1.0;
-   d1 = d2 = g1 = g2 = 0.0;
-   xn1 = xn2 = yn1 = yn2 = 0.0;
-#endif
-   sample_in_ptr = 0;
-   memset(sample_buf, 0, SAMPLE_BUF_SIZE);
+
+   // Pending writes were to the old state
+   queue_head = queue_end = queue_tail;
 }
 
 
 /*
- *  Write to register
+ *  Write to register: Queue the write with the cycle it happened at,
+ *  calc_buffer() applies it
  */
 
 void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 {
-   int v;
    if (!ready)
       return;
 
-   v = adr / 7;	// Voice number
+   // Queue full (calc_buffer() not called for a long time)? Then
+   // the oldest write can't wait any longer
+   if (queue_tail - QUEUE_LOAD(queue_head) == WRITE_QUEUE_SIZE)
+   {
+#ifdef HAVE_THREADS
+      wait_job();
+#endif
+      if (queue_tail - queue_head == WRITE_QUEUE_SIZE)
+      {
+         SIDWrite *w = &write_queue[queue_head++ % WRITE_QUEUE_SIZE];
+         apply_write(w->adr, w->byte);
+      }
+   }
+
+   uint32 delta = the_c64->CycleCounter - line_cycle;
+   if (delta >= LINE_CYCLES)
+      delta = LINE_CYCLES - 1;
+
+   SIDWrite *w = &write_queue[queue_tail % WRITE_QUEUE_SIZE];
+   w->time = line_clock + delta;
+   w->adr  = adr;
+   w->byte = byte;
+   QUEUE_STORE(queue_tail, queue_tail + 1);
+}
+
+
+/*
+ *  Apply register write to the renderer state
+ */
+
+void DigitalRenderer::apply_write(uint16 adr, uint8 byte)
+{
+   int v = adr / 7;	// Voice number
 
    switch (adr)
    {
       case 0:
       case 7:
       case 14:
-         voice[v].freq = (voice[v].freq & 0xff00) | byte;
+         voice.freq[v] = (voice.freq[v] & 0xff00) | byte;
 #ifdef USE_FIXPOINT_MATHS
-         voice[v].add = sidquot.imul((int)voice[v].freq);
+         voice.add[v] = sidquot.imul((int)voice.freq[v]);
 #else
-         voice[v].add = (uint32)((float)voice[v].freq * SID_FREQ / SAMPLE_FREQ);
+         voice.add[v] = (uint32)((float)voice.freq[v] * SID_FREQ / synth_freq);
 #endif
          break;
 
       case 1:
       case 8:
       case 15:
-         voice[v].freq = (voice[v].freq & 0xff) | (byte << 8);
+         voice.freq[v] = (voice.freq[v] & 0xff) | (byte << 8);
 #ifdef USE_FIXPOINT_MATHS
-         voice[v].add = sidquot.imul((int)voice[v].freq);
+         voice.add[v] = sidquot.imul((int)voice.freq[v]);
 #else
-         voice[v].add = (uint32)((float)voice[v].freq * SID_FREQ / SAMPLE_FREQ);
+         voice.add[v] = (uint32)((float)voice.freq[v] * SID_FREQ / synth_freq);
 #endif
          break;
 
       case 2:
       case 9:
       case 16:
-         voice[v].pw = (voice[v].pw & 0x0f00) | byte;
+         voice.pw[v] = (voice.pw[v] & 0x0f00) | byte;
          break;
 
       case 3:
       case 10:
       case 17:
-         voice[v].pw = (voice[v].pw & 0xff) | ((byte & 0xf) << 8);
+         voice.pw[v] = (voice.pw[v] & 0xff) | ((byte & 0xf) << 8);
          break;
 
       case 4:
       case 11:
       case 18:
-         voice[v].wave = (byte >> 4) & 0xf;
-         if ((byte & 1) != voice[v].gate)
+         voice.wave[v] = (byte >> 4) & 0xf;
+         if ((byte & 1) != voice.gate[v])
          {
             if (byte & 1)	// Gate turned on
-               voice[v].eg_state = EG_ATTACK;
+               voice.eg_state[v] = EG_ATTACK;
             else			// Gate turned off
             {
-               if (voice[v].eg_state != EG_IDLE)
-                  voice[v].eg_state = EG_RELEASE;
+               if (voice.eg_state[v] != EG_IDLE)
+                  voice.eg_state[v] = EG_RELEASE;
             }
          }
-         voice[v].gate = byte & 1;
-         voice[v].mod_by->sync = byte & 2;
-         voice[v].ring = byte & 4;
-         if ((voice[v].test = byte & 8) != 0)
-            voice[v].count = 0;
+         voice.gate[v] = byte & 1;
+         voice.sync[VoiceModBy[v]] = byte & 2;
+         voice.ring[v] = byte & 4;
+         if ((voice.test[v] = byte & 8) != 0)
+            voice.count[v] = 0;
          break;
 
       case 5:
       case 12:
       case 19:
-         voice[v].a_add = EGTable[byte >> 4];
-         voice[v].d_sub = EGTable[byte & 0xf];
+         voice.a_add[v] = EGTable[byte >> 4];
+         voice.d_sub[v] = EGTable[byte & 0xf];
          break;
 
       case 6:
       case 13:
       case 20:
-         voice[v].s_level = (byte >> 4) * 0x111111;
-         voice[v].r_sub = EGTable[byte & 0xf];
+         voice.s_level[v] = (byte >> 4) * 0x111111;
+         voice.r_sub[v] = EGTable[byte & 0xf];
          break;
 
       case 22:
          if (byte != f_freq)
          {
             f_freq = byte;
-            if (ThePrefs.SIDFilters)
+            if (the_c64->MachinePrefs->SIDFilters)
                calc_filter();
          }
          break;
 
       case 23:
-         voice[0].filter = byte & 1;
-         voice[1].filter = byte & 2;
-         voice[2].filter = byte & 4;
+         voice.filter[0] = byte & 1;
+         voice.filter[1] = byte & 2;
+         voice.filter[2] = byte & 4;
          if ((byte >> 4) != f_res) {
             f_res = byte >> 4;
-            if (ThePrefs.SIDFilters)
+            if (the_c64->MachinePrefs->SIDFilters)
                calc_filter();
          }
          break;
 
       case 24:
          volume = byte & 0xf;
-         voice[2].mute = byte & 0x80;
+         voice.mute[2] = byte & 0x80;
          if (((byte >> 4) & 7) != f_type)
          {
             f_type = (byte >> 4) & 7;
-#ifdef USE_FIXPOINT_MATHS
             xn1    = xn2 = yn1 = yn2 = 0;
-#else
-            xn1    = xn2 = yn1 = yn2 = 0.0;
-#endif
-            if (ThePrefs.SIDFilters)
+            if (the_c64->MachinePrefs->SIDFilters)
                calc_filter();
          }
          break;
@@ -927,332 +1190,507 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 
 void DigitalRenderer::NewPrefs(Prefs *prefs)
 {
+#ifdef HAVE_THREADS
+	wait_job();
+#endif
 	calc_filter();
 }
 
 
 /*
- *  Calculate IIR filter coefficients
+ *  Calculate the IIR filter coefficients for all filter types,
+ *  resonances and cutoff frequencies at a sample frequency
  */
 
-void DigitalRenderer::calc_filter(void)
+FilterTable *DigitalRenderer::calc_filter_table(uint32 synth_freq)
 {
-#ifdef USE_FIXPOINT_MATHS
-	FixPoint fr, arg;
+	FilterTable *tab = new FilterTable;
+	int type, res, freq;
+
+	for (type = FILT_LP; type < FILT_ALL; type++)
+		for (freq = 0; freq < 256; freq++)
+		{
+			double fr, arg;
+
+			// Calculate resonance frequency
+			if (type == FILT_LP || type == FILT_LPBP)
+				fr = CALC_RESONANCE_LP(freq);
+			else
+				fr = CALC_RESONANCE_HP(freq);
+
+			// Limit to <1/2 sample frequency, avoid div by 0 in case FILT_BP below
+			arg = fr / (double)(synth_freq >> 1);
+			if (arg > 0.99)
+				arg = 0.99;
+			if (arg < 0.01)
+				arg = 0.01;
+
+			if (type == FILT_NOTCH)
+				tab->notch_d1[freq] = (int32)(-2.0 * cos(M_PI * arg) * COEF_ONE);
+
+			for (res = 0; res < 16; res++)
+			{
+				double g1, g2, ampl;
+
+				// Calculate poles (resonance frequency and resonance)
+				g2 = 0.55 + 1.2 * arg * arg - 1.2 * arg + (double)res * 0.0133333333;
+				g1 = -2.0 * sqrt(g2) * cos(M_PI * arg);
+
+				// Increase resonance if LP/HP combined with BP
+				if (type == FILT_LPBP || type == FILT_HPBP)
+					g2 += 0.1;
+
+				// Stabilize filter
+				if (fabs(g1) >= g2 + 1.0)
+				{
+					if (g1 > 0.0)
+						g1 = g2 + 0.99;
+					else
+						g1 = -(g2 + 0.99);
+				}
+
+				// Input attenuation
+				if (type == FILT_LP || type == FILT_LPBP)
+					ampl = 0.25 * (1.0 + g1 + g2);
+				else if (type == FILT_HP || type == FILT_HPBP)
+					ampl = 0.25 * (1.0 - g1 + g2);
+				else
+					ampl = 0.25 * (1.0 + g1 + g2) * (1 + cos(M_PI * arg)) / sin(M_PI * arg);
+
+				FilterCoef *c = &tab->coef[((type - 1) * 16 + res) * 256 + freq];
+				c->ampl = (int32)(ampl * COEF_ONE);
+				c->g1   = (int32)(g1 * COEF_ONE);
+				c->g2   = (int32)(g2 * COEF_ONE);
+			}
+		}
+	return tab;
+}
 
-	if (f_type == FILT_ALL)
-	{
-		d1 = 0;
-      d2 = 0;
-      g1 = 0;
-      g2 = 0;
-      f_ampl = FixNo(1);
-      return;
-	}
-	else if (f_type == FILT_NONE)
-   {
-      d1 = 0;
-      d2 = 0;
-      g1 = 0;
-      g2 = 0;
-      f_ampl = 0;
-      return;
-   }
-#else
-	float fr, arg;
 
+/*
+ *  Get IIR filter coefficients for the current filter settings
+ */
+
+void DigitalRenderer::calc_filter(void)
+{
 	// Check for some trivial cases
 	if (f_type == FILT_ALL)
-   {
-      d1 = 0.0; d2 = 0.0;
-      g1 = 0.0; g2 = 0.0;
-      f_ampl = 1.0;
-      return;
-   }
-   else if (f_type == FILT_NONE)
-   {
-      d1 = 0.0; d2 = 0.0;
-      g1 = 0.0; g2 = 0.0;
-      f_ampl = 0.0;
-      return;
-   }
-#endif
-
-	// Calculate resonance frequency
-	if (f_type == FILT_LP || f_type == FILT_LPBP)
-#ifdef PRECOMPUTE_RESONANCE
-		fr = resonanceLP[f_freq];
-#else
-		fr = CALC_RESONANCE_LP(f_freq);
-#endif
-	else
-#ifdef PRECOMPUTE_RESONANCE
-		fr = resonanceHP[f_freq];
-#else
-		fr = CALC_RESONANCE_HP(f_freq);
-#endif
-
-#ifdef USE_FIXPOINT_MATHS
-	// explanations see below.
-	arg = fr / (SAMPLE_FREQ >> 1);
-	if (arg > FixNo(0.99)) {arg = FixNo(0.99);}
-	if (arg < FixNo(0.01)) {arg = FixNo(0.01);}
-
-	g2 = FixNo(0.55) + FixNo(1.2) * arg * (arg - 1) + FixNo(0.0133333333) * f_res;
-	g1 = FixNo(-2) * g2.sqrt() * fixcos(arg);
-
-	if (f_type == FILT_LPBP || f_type == FILT_HPBP) {g2 += FixNo(0.1);}
-
-	if (g1.abs() >= g2 + 1)
 	{
-	  if (g1 > 0) {g1 = g2 + FixNo(0.99);}
-	  else {g1 = -(g2 + FixNo(0.99));}
+		d1 = d2 = g1 = g2 = 0;
+		f_ampl = COEF_ONE;
+		return;
 	}
-
-	switch (f_type)
+	else if (f_type == FILT_NONE)
 	{
-	  case FILT_LPBP:
-	  case FILT_LP:
-		d1 = FixNo(2); d2 = FixNo(1); f_ampl = FixNo(0.25) * (1 + g1 + g2); break;
-	  case FILT_HPBP:
-	  case FILT_HP:
-		d1 = FixNo(-2); d2 = FixNo(1); f_ampl = FixNo(0.25) * (1 - g1 + g2); break;
-	  case FILT_BP:
-		d1 = 0; d2 = FixNo(-1);
-		f_ampl = FixNo(0.25) * (1 + g1 + g2) * (1 + fixcos(arg)) / fixsin(arg);
-		break;
-	  case FILT_NOTCH:
-		d1 = FixNo(-2) * fixcos(arg); d2 = FixNo(1);
-		f_ampl = FixNo(0.25) * (1 + g1 + g2) * (1 + fixcos(arg)) / fixsin(arg);
-		break;
-	  default: break;
+		d1 = d2 = g1 = g2 = 0;
+		f_ampl = 0;
+		return;
 	}
 
-#else
-
-	// Limit to <1/2 sample frequency, avoid div by 0 in case FILT_BP below
-	arg = fr / (float)(SAMPLE_FREQ >> 1);
-	if (arg > 0.99)
-		arg = 0.99;
-	if (arg < 0.01)
-		arg = 0.01;
-
-	// Calculate poles (resonance frequency and resonance)
-	g2 = 0.55 + 1.2 * arg * arg - 1.2 * arg + (float)f_res * 0.0133333333;
-	g1 = -2.0 * sqrt(g2) * cos(M_PI * arg);
-
-	// Increase resonance if LP/HP combined with BP
-	if (f_type == FILT_LPBP || f_type == FILT_HPBP)
-		g2 += 0.1;
-
-	// Stabilize filter
-	if (fabs(g1) >= g2 + 1.0)
-        {
-		if (g1 > 0.0)
-			g1 = g2 + 0.99;
-		else
-			g1 = -(g2 + 0.99);
-        }
-
-	// Calculate roots (filter characteristic) and input attenuation
-	switch (f_type) {
+	const FilterCoef *c = &filter_tab->coef[((f_type - 1) * 16 + f_res) * 256 + f_freq];
+	f_ampl = c->ampl;
+	g1     = c->g1;
+	g2     = c->g2;
 
+	// Roots (filter characteristic)
+	switch (f_type)
+	{
 		case FILT_LPBP:
 		case FILT_LP:
-			d1 = 2.0; d2 = 1.0;
-			f_ampl = 0.25 * (1.0 + g1 + g2);
+			d1 = 2 * COEF_ONE; d2 = COEF_ONE;
 			break;
 
 		case FILT_HPBP:
 		case FILT_HP:
-			d1 = -2.0; d2 = 1.0;
-			f_ampl = 0.25 * (1.0 - g1 + g2);
+			d1 = -2 * COEF_ONE; d2 = COEF_ONE;
 			break;
 
 		case FILT_BP:
-			d1 = 0.0; d2 = -1.0;
-			f_ampl = 0.25 * (1.0 + g1 + g2) * (1 + cos(M_PI * arg)) / sin(M_PI * arg);
+			d1 = 0; d2 = -COEF_ONE;
 			break;
 
 		case FILT_NOTCH:
-			d1 = -2.0 * cos(M_PI * arg); d2 = 1.0;
-			f_ampl = 0.25 * (1.0 + g1 + g2) * (1 + cos(M_PI * arg)) / (sin(M_PI * arg));
-			break;
-
-		default:
+			d1 = filter_tab->notch_d1[f_freq]; d2 = COEF_ONE;
 			break;
 	}
-#endif
 }
 
 /*
- *  Fill one audio buffer with calculated SID sound
+ *  Fill one audio buffer with calculated SID sound, applying the
+ *  queued register writes that are due in between
  */
 
 void DigitalRenderer::calc_buffer(int16 *buf, long count)
 {
-   // Get filter coefficients, so the emulator won't change
-   // them in the middle of our calculations
-#ifdef USE_FIXPOINT_MATHS
-   FixPoint cf_ampl = f_ampl;
-   FixPoint cd1     = d1, cd2 = d2, cg1 = g1, cg2 = g2;
-#else
-   float cf_ampl    = f_ampl;
-   float cd1        = d1, cd2 = d2, cg1 = g1, cg2 = g2;
-#endif
-   // Index in sample_buf for reading, 16.16 fixed
-   uint32 sample_count = (sample_in_ptr + SAMPLE_BUF_SIZE/2) << 16;
-
    count >>= 1;	// 16 bit mono output, count is in bytes
-   while (count--)
+   while (count > 0)
+   {
+      // Apply all writes up to the next sample
+      while ((int32)(queue_end - queue_head) > 0)
+      {
+         SIDWrite *w = &write_queue[queue_head % WRITE_QUEUE_SIZE];
+         if ((int32)(w->time - sample_clock) > 0)
+            break;
+         apply_write(w->adr, w->byte);
+         QUEUE_STORE(queue_head, queue_head + 1);
+      }
+
+      // Number of samples until the next write
+      long n = count;
+      if ((int32)(queue_end - queue_head) > 0)
+      {
+         uint32 delta = write_queue[queue_head % WRITE_QUEUE_SIZE].time - sample_clock;
+         uint64 until = ((uint64)delta * synth_freq - sample_frac + TIMELINE_FREQ - 1) / TIMELINE_FREQ;
+         if (until < (uint64)n)
+            n = (long)until;
+      }
+
+      calc_samples(buf, n);
+      buf   += n;
+      count -= n;
+
+      // Advance the sample clock by n samples
+      uint64 frac   = sample_frac + (uint64)n * TIMELINE_FREQ;
+      sample_clock += (uint32)(frac / synth_freq);
+      sample_frac   = (uint32)(frac % synth_freq);
+   }
+}
+
+
+/*
+ *  Calculate samples with fixed register values, in blocks of
+ *  CALC_BLOCK samples: First the envelopes and oscillators of all
+ *  voices, then the waveforms, then the filter
+ */
+
+void DigitalRenderer::calc_samples(int16 *buf, long count)
+{
+   // Get filter coefficients, they only change between calls
+   int32 cf_ampl = f_ampl;
+   int32 cd1     = d1, cd2 = d2, cg1 = g1, cg2 = g2;
+   // Master volume, calculate sampled voice
+   uint8 master_volume = volume;
+   int32 sampled       = SampleTab[master_volume] << 8;
+   bool filters        = the_c64->MachinePrefs->SIDFilters;
+
+   uint16 env[3][CALC_BLOCK];			// Envelope of each voice, including master volume
+   uint32 cnt[3][CALC_BLOCK+1];		// Waveform counter of each voice, [0] is the one before the block
+   uint16 noise_out[3][CALC_BLOCK];	// Noise generator output of each voice
+   int32 sum_output[CALC_BLOCK];
+   int32 sum_output_filter[CALC_BLOCK];
+
+   while (count > 0)
    {
-      // Get current master volume from sample buffer,
-      // calculate sampled voice
-      uint8 master_volume     = sample_buf[(sample_count >> 16) 
-         % SAMPLE_BUF_SIZE];
-      sample_count           += ((0x138 * 50) << 16) / SAMPLE_FREQ;
-      int32 sum_output        = SampleTab[master_volume] << 8;
-      int32 sum_output_filter = 0;
-
-      // Loop for all three voices
-      for (int j=0; j<3; j++) {
-         DRVoice *v = &voice[j];
-
-         // Envelope generators
-         uint16 envelope;
-
-         switch (v->eg_state)
+      int n = count < CALC_BLOCK ? (int)count : CALC_BLOCK;
+      int i, j;
+
+      // Nothing audible? Then only keep the muted envelopes and the
+      // oscillators running and output the level of the sampled voice
+      if (is_silent())
+      {
+         for (j = 0; j < 3; j++)
+            if (voice.eg_state[j] != EG_IDLE)
+               calc_envelope(j, master_volume, env[j], n);
+         calc_oscillators(cnt, noise_out, n);
+
+         int16 level = sampled >> 10;
+         for (i = 0; i < n; i++)
+            *buf++ = level;
+
+         count -= n;
+         continue;
+      }
+
+      // Envelope generators
+      for (j = 0; j < 3; j++)
+         calc_envelope(j, master_volume, env[j], n);
+
+      // Waveform generators
+      calc_oscillators(cnt, noise_out, n);
+
+      for (i = 0; i < n; i++)
+      {
+         sum_output[i]        = sampled;
+         sum_output_filter[i] = 0;
+      }
+      for (j = 0; j < 3; j++)
+      {
+         if (voice.mute[j])
+            continue;
+
+         // A voice modulated by a voice that comes later in the
+         // sample sees the counter of the previous sample
+         int m = VoiceModBy[j];
+         calc_waveform(j, cnt[j] + 1, cnt[m] + (m < j ? 1 : 0), noise_out[j], env[j],
+               voice.filter[j] ? sum_output_filter : sum_output, n);
+      }
+
+      // Filter
+      for (i = 0; i < n; i++)
+      {
+         int32 sum_filter = sum_output_filter[i];
+         if (filters)
          {
-            case EG_ATTACK:
-               v->eg_level += v->a_add;
-               if (v->eg_level > 0xffffff)
+            int32 xn   = (int32)(((int64)sum_filter * cf_ampl) >> 15);
+            int32 yn   = xn + (int32)(((int64)cd1 * xn1 + (int64)cd2 * xn2
+                     - (int64)cg1 * yn1 - (int64)cg2 * yn2) >> 15);
+            yn2        = yn1;
+            yn1        = yn;
+            xn2        = xn1;
+            xn1        = xn;
+            sum_filter = yn;
+         }
+
+         // Write to buffer
+         *buf++ = (sum_output[i] + sum_filter) >> 10;
+      }
+
+      count -= n;
+   }
+}
+
+
+/*
+ *  Check whether the voices and the filter are silent, so the
+ *  output is only the sampled voice
+ */
+
+bool DigitalRenderer::is_silent(void)
+{
+   for (int j = 0; j < 3; j++)
+      if (voice.eg_state[j] != EG_IDLE && !voice.mute[j])
+         return false;
+
+   if (!the_c64->MachinePrefs->SIDFilters)
+      return true;
+
+   // Filter still ringing?
+   if (xn1 <= -SILENCE_LEVEL || xn1 >= SILENCE_LEVEL
+         || xn2 <= -SILENCE_LEVEL || xn2 >= SILENCE_LEVEL
+         || yn1 <= -SILENCE_LEVEL || yn1 >= SILENCE_LEVEL
+         || yn2 <= -SILENCE_LEVEL || yn2 >= SILENCE_LEVEL)
+      return false;
+
+   // Let it decay the rest of the way at once
+   xn1 = xn2 = yn1 = yn2 = 0;
+   return true;
+}
+
+
+/*
+ *  Envelope generator of one voice for n samples, multiplied
+ *  by the master volume
+ */
+
+void DigitalRenderer::calc_envelope(int j, uint8 master_volume, uint16 *env, int n)
+{
+   uint32 level   = voice.eg_level[j];
+   int state      = voice.eg_state[j];
+   uint32 s_level = voice.s_level[j];
+   int i = 0;
+
+   while (i < n)
+   {
+      switch (state)
+      {
+         case EG_ATTACK:
+            while (i < n && state == EG_ATTACK)
+            {
+               level += voice.a_add[j];
+               if (level > 0xffffff)
                {
-                  v->eg_level = 0xffffff;
-                  v->eg_state = EG_DECAY;
+                  level = 0xffffff;
+                  state = EG_DECAY;
                }
-               break;
-            case EG_DECAY:
-               if (v->eg_level <= v->s_level || v->eg_level > 0xffffff)
-                  v->eg_level = v->s_level;
+               env[i++] = (level * master_volume) >> 20;
+            }
+            break;
+         case EG_DECAY:
+            while (i < n && level != s_level)
+            {
+               if (level <= s_level || level > 0xffffff)
+                  level = s_level;
                else
                {
-                  v->eg_level -= v->d_sub >> EGDRShift[v->eg_level >> 16];
-                  if (v->eg_level <= v->s_level || v->eg_level > 0xffffff)
-                     v->eg_level = v->s_level;
+                  level -= voice.d_sub[j] >> EGDRShift[level >> 16];
+                  if (level <= s_level || level > 0xffffff)
+                     level = s_level;
                }
-               break;
-            case EG_RELEASE:
-               v->eg_level -= v->r_sub >> EGDRShift[v->eg_level >> 16];
-               if (v->eg_level > 0xffffff)
+               env[i++] = (level * master_volume) >> 20;
+            }
+            // Sustain
+            while (i < n)
+               env[i++] = (level * master_volume) >> 20;
+            break;
+         case EG_RELEASE:
+            while (i < n && state == EG_RELEASE)
+            {
+               level -= voice.r_sub[j] >> EGDRShift[level >> 16];
+               if (level > 0xffffff)
                {
-                  v->eg_level = 0;
-                  v->eg_state = EG_IDLE;
+                  level = 0;
+                  state = EG_IDLE;
                }
-               break;
-            case EG_IDLE:
-               v->eg_level = 0;
-               break;
-         }
-         envelope = (v->eg_level * master_volume) >> 20;
+               env[i++] = (level * master_volume) >> 20;
+            }
+            break;
+         case EG_IDLE:
+            level = 0;
+            while (i < n)
+               env[i++] = 0;
+            break;
+      }
+   }
 
-         // Waveform generator
-         if (v->mute)
-            continue;
-         uint16 output;
+   voice.eg_level[j] = level;
+   voice.eg_state[j] = state;
+}
 
-         if (!v->test)
-            v->count += v->add;
 
-         if (v->sync && (v->count > 0x1000000))
-            v->mod_to->count = 0;
+/*
+ *  Waveform counters of all voices for n samples, and the noise
+ *  generator output of the voices playing noise
+ */
 
-         v->count &= 0xffffff;
+void DigitalRenderer::calc_oscillators(uint32 cnt[3][CALC_BLOCK+1], uint16 noise_out[3][CALC_BLOCK], int n)
+{
+   int i, j;
+   int noise_voices = 0;
+   bool sync        = false;
 
-         switch (v->wave)
+   for (j = 0; j < 3; j++)
+   {
+      cnt[j][0] = voice.count[j];
+      if (voice.mute[j])
+         continue;
+      if (voice.sync[j])
+         sync = true;
+      if (voice.wave[j] == WAVE_NOISE)
+         noise_voices++;
+   }
+
+   if (sync || noise_voices > 1)
+   {
+      // Voices depend on each other (or draw from the same random
+      // numbers), calculate them sample by sample
+      for (i = 1; i <= n; i++)
+         for (j = 0; j < 3; j++)
          {
-            case WAVE_TRI:
-               if (v->ring)
-                  output = TriTable[(v->count 
-                        ^ (v->mod_by->count & 0x800000)) >> 11];
-               else
-                  output = TriTable[v->count >> 11];
-               break;
-            case WAVE_SAW:
-               output = v->count >> 8;
-               break;
-            case WAVE_RECT:
-               if (v->count > (uint32)(v->pw << 12))
-                  output = 0xffff;
-               else
-                  output = 0;
-               break;
-            case WAVE_TRISAW:
-               output = TriSawTable[v->count >> 16];
-               break;
-            case WAVE_TRIRECT:
-               if (v->count > (uint32)(v->pw << 12))
-                  output = TriRectTable[v->count >> 16];
-               else
-                  output = 0;
-               break;
-            case WAVE_SAWRECT:
-               if (v->count > (uint32)(v->pw << 12))
-                  output = SawRectTable[v->count >> 16];
-               else
-                  output = 0;
-               break;
-            case WAVE_TRISAWRECT:
-               if (v->count > (uint32)(v->pw << 12))
-                  output = TriSawRectTable[v->count >> 16];
-               else
-                  output = 0;
-               break;
-            case WAVE_NOISE:
-               if (v->count > 0x100000)
+            if (!voice.mute[j])
+            {
+               if (!voice.test[j])
+                  voice.count[j] += voice.add[j];
+
+               if (voice.sync[j] && (voice.count[j] > 0x1000000))
+                  voice.count[VoiceModTo[j]] = 0;
+
+               voice.count[j] &= 0xffffff;
+
+               if (voice.wave[j] == WAVE_NOISE && voice.count[j] > 0x100000)
                {
-                  output = v->noise = sid_random() << 8;
-                  v->count &= 0xfffff;
+                  voice.noise[j] = sid_random(noise_seed) << 8;
+                  voice.count[j] &= 0xfffff;
                }
-               else
-                  output = v->noise;
-               break;
-            default:
-               output = 0x8000;
-               break;
+            }
+            cnt[j][i]         = voice.count[j];
+            noise_out[j][i-1] = voice.noise[j];
          }
-         if (v->filter)
-            sum_output_filter += (int16)(output ^ 0x8000) * envelope;
-         else
-            sum_output        += (int16)(output ^ 0x8000) * envelope;
-      }
+      return;
+   }
 
-      // Filter
-      if (ThePrefs.SIDFilters)
+   // Voices are independent, calculate them one after the other
+   for (j = 0; j < 3; j++)
+   {
+      uint32 *c  = cnt[j] + 1;
+      uint32 c0  = voice.count[j];
+      uint32 add = voice.add[j];
+
+      if (voice.mute[j])
+         for (i = 0; i < n; i++)
+            c[i] = c0;
+      else if (voice.wave[j] == WAVE_NOISE)
       {
-#ifdef USE_FIXPOINT_MATHS
-         int32 xn          = cf_ampl.imul(sum_output_filter);
-         int32 yn          = xn + cd1.imul(xn1) + cd2.imul(xn2) - cg1.imul(yn1) - cg2.imul(yn2);
-         yn2               = yn1;
-         yn1               = yn;
-         xn2               = xn1;
-         xn1               = xn;
-         sum_output_filter = yn;
-#else
-         float xn          = (float)sum_output_filter * cf_ampl;
-         float yn          = xn + cd1 * xn1 + cd2 * xn2 - cg1 * yn1 - cg2 * yn2;
-         yn2               = yn1;
-         yn1               = yn;
-         xn2               = xn1;
-         xn1               = xn;
-         sum_output_filter = (int32)yn;
-#endif
+         uint32 noise = voice.noise[j];
+         if (voice.test[j])
+            add = 0;
+         for (i = 0; i < n; i++)
+         {
+            c0 = (c0 + add) & 0xffffff;
+            if (c0 > 0x100000)
+            {
+               noise = sid_random(noise_seed) << 8;
+               c0 &= 0xfffff;
+            }
+            c[i]            = c0;
+            noise_out[j][i] = noise;
+         }
+         voice.noise[j] = noise;
+         voice.count[j] = c0;
+      }
+      else if (voice.test[j])
+         for (i = 0; i < n; i++)
+            c[i] = c0;
+      else
+      {
+         for (i = 0; i < n; i++)
+            c[i] = (c0 + (uint32)(i + 1) * add) & 0xffffff;
+         voice.count[j] = c[n-1];
       }
+   }
+}
+
+
+/*
+ *  Waveform of one voice for n samples, multiplied with the
+ *  envelope and added to sum
+ */
+
+#define MIX_WAVE(output) \
+   for (i = 0; i < n; i++) \
+      sum[i] += (int16)((output) ^ 0x8000) * env[i]
+
+void DigitalRenderer::calc_waveform(int j, const uint32 *cnt, const uint32 *ring_cnt, const uint16 *noise_out,
+      const uint16 *env, int32 *sum, int n)
+{
+   uint32 pw = voice.pw[j] << 12;
+   int i;
 
-      // Write to buffer
-      *buf++ = (sum_output + sum_output_filter) >> 10;
+   switch (voice.wave[j])
+   {
+      case WAVE_TRI:
+         if (voice.ring[j])
+            MIX_WAVE(TriTable[(cnt[i] ^ (ring_cnt[i] & 0x800000)) >> 11]);
+         else
+            MIX_WAVE(TriTable[cnt[i] >> 11]);
+         break;
+      case WAVE_SAW:
+         MIX_WAVE(cnt[i] >> 8);
+         break;
+      case WAVE_RECT:
+         MIX_WAVE(cnt[i] > pw ? 0xffff : 0);
+         break;
+      case WAVE_TRISAW:
+         MIX_WAVE(TriSawTable[cnt[i] >> 16]);
+         break;
+      case WAVE_TRIRECT:
+         MIX_WAVE(cnt[i] > pw ? TriRectTable[cnt[i] >> 16] : 0);
+         break;
+      case WAVE_SAWRECT:
+         MIX_WAVE(cnt[i] > pw ? SawRectTable[cnt[i] >> 16] : 0);
+         break;
+      case WAVE_TRISAWRECT:
+         MIX_WAVE(cnt[i] > pw ? TriSawRectTable[cnt[i] >> 16] : 0);
+         break;
+      case WAVE_NOISE:
+         MIX_WAVE(noise_out[i]);
+         break;
+      default:	// Silent (output 0x8000)
+         break;
    }
 }
 
+#undef MIX_WAVE
+
 /*
  *  SID_linux.i - 6581 emulation, Linux specific stuff
  *
@@ -1261,24 +1699,46 @@ void DigitalRenderer::calc_buffer(int16 *buf, long count)
  */
 
 
-#include "VIC.h"
-
 /* Initialization */
 void DigitalRenderer::init_sound(void)
 {
-#if !defined(SF2000)
-   sndbufsize   = 882;   // 44100 / 50 = 882 samples per frame
-#else
-   sndbufsize   = 441;   // 22050 / 50 = 441 samples per frame  
+   sound_buffer = NULL;
+   set_output_freq(the_c64->MachinePrefs->SampleRate);
+   ready        = true;
+}
+
+
+/* Set output sample frequency, one buffer holds a frame */
+void DigitalRenderer::set_output_freq(int freq)
+{
+#ifdef HAVE_THREADS
+   wait_job();
 #endif
+   prefs_freq = freq;
+   if (freq < (int)MIN_OUTPUT_FREQ)
+      freq = MIN_OUTPUT_FREQ;
+   else if (freq > (int)MAX_OUTPUT_FREQ)
+      freq = MAX_OUTPUT_FREQ;
+
+   output_freq  = freq;
+   sndbufsize   = freq / CALC_FREQ + 1;   // Samples per frame, rounded up
+   delete[] sound_buffer;
    sound_buffer = new int16[sndbufsize*2];
-   ready        = true;
+#ifdef HAVE_THREADS
+   lead_in();
+#endif
+   resampler.SetRates(synth_freq, output_freq);
 }
 
 
 /* Destructor */
 DigitalRenderer::~DigitalRenderer()
 {
+#ifdef HAVE_THREADS
+   if (thread)
+      stop_thread();
+#endif
+   delete[] sound_buffer;
 }
 
 /* Pause sound output */
@@ -1294,44 +1754,177 @@ void DigitalRenderer::Resume(void)
 
 
 /*
- * Fill buffer, sample volume (for sampled voice)
+ * Calculate count output samples, and the samples the resampler
+ * needs for them
  */
 
-extern short signed int SNDBUF[1024*2];
+void DigitalRenderer::calc_frame(int16 *buf, int count)
+{
+   int synth_len;
+   int16 *synth_buf = resampler.InputBuffer(count, synth_len);
+   calc_buffer(synth_buf, synth_len*2);
+   resampler.Process(buf, count);
+}
+
+
+#ifdef HAVE_THREADS
+/*
+ * Worker thread: Calculate the frames VBlank() hands over
+ */
+
+void DigitalRenderer::thread_func(void *arg)
+{
+   DigitalRenderer *r = (DigitalRenderer *)arg;
+
+   slock_lock(r->job_lock);
+   for (;;)
+   {
+      while (!r->job_len && !r->job_quit)
+         scond_wait(r->job_cond, r->job_lock);
+      if (r->job_quit)
+         break;
+
+      int len = r->job_len;
+      slock_unlock(r->job_lock);
+      r->calc_frame(r->job_buf, len);
+      slock_lock(r->job_lock);
+
+      r->job_len = 0;
+      scond_signal(r->job_cond);
+   }
+   slock_unlock(r->job_lock);
+}
+
+
+/* Start/stop the worker thread */
+void DigitalRenderer::start_thread(void)
+{
+   job_len   = 0;
+   lead_in();
+   job_quit = false;
+   job_lock = slock_new();
+   job_cond = scond_new();
+   thread   = sthread_create(thread_func, this);
+   if (!thread)
+   {
+      scond_free(job_cond);
+      slock_free(job_lock);
+   }
+}
+
+void DigitalRenderer::stop_thread(void)
+{
+   wait_job();
+   slock_lock(job_lock);
+   job_quit = true;
+   scond_signal(job_cond);
+   slock_unlock(job_lock);
+
+   sthread_join(thread);
+   thread = NULL;
+   scond_free(job_cond);
+   slock_free(job_lock);
+}
+
+
+/* The worker starts a frame behind, with a frame of silence */
+void DigitalRenderer::lead_in(void)
+{
+   ahead_len = output_freq / CALC_FREQ;
+   memset(sound_buffer, 0, ahead_len*2);
+}
+
+
+/* Wait until the worker is idle, then the renderer state may be changed */
+void DigitalRenderer::wait_job(void)
+{
+   if (!thread)
+      return;
+
+   slock_lock(job_lock);
+   while (job_len)
+      scond_wait(job_cond, job_lock);
+   slock_unlock(job_lock);
+}
+#endif
+
+
+/*
+ * Start timestamping the writes of a raster line
+ */
 
 void DigitalRenderer::EmulateLine(void)
 {
-   static int divisor = 0;
-   static int to_output = 0;
-   static int buffer_pos = 0;
+   if (!ready)
+      return;
 
+   line_clock += LINE_CYCLES;
+   line_cycle  = the_c64->CycleCounter;
+
+   // Output frequency changed in the prefs?
+   if (prefs_freq != the_c64->MachinePrefs->SampleRate)
+      set_output_freq(the_c64->MachinePrefs->SampleRate);
+
+#ifdef HAVE_THREADS
+   // Worker thread switched on or off?
+   if (the_c64->MachinePrefs->SIDThread != (thread != NULL))
+   {
+      if (thread)
+         stop_thread();
+      else
+         start_thread();
+   }
+#endif
+}
+
+
+/*
+ * Calculate count samples of the frame that ended into buf
+ */
+
+void DigitalRenderer::VBlank(int16 *buf, int count)
+{
    if (!ready)
+   {
+      memset(buf, 0, count*2);
       return;
+   }
 
-   sample_buf[sample_in_ptr] = volume;
-   sample_in_ptr             = (sample_in_ptr + 1) % SAMPLE_BUF_SIZE;
-
-   /*
-    * Now see how many samples have to be added for this line
-    */
-   divisor += SAMPLE_FREQ;
-   while (divisor >= 0)
-      divisor -= TOTAL_RASTERS*SCREEN_FREQ, to_output++;
-
-   /*
-    * Calculate the sound data only when we have enough to fill
-    * the buffer entirely.
-    */
-   if ((buffer_pos + to_output) >= sndbufsize)
+#ifdef HAVE_THREADS
+   if (thread)
    {
-      int datalen  = sndbufsize - buffer_pos;
-      to_output   -= datalen;
-      calc_buffer(sound_buffer + buffer_pos, datalen*2);
-      memcpy(SNDBUF, sound_buffer , sndbufsize*2);
-      //	retro_audiocb(sound_buffer, sndbufsize);
-      //	write(devfd, sound_buffer, sndbufsize*2);
-      buffer_pos = 0;
-   }    
+      // Hand out what the worker calculated ahead, only a frame longer
+      // than the lead-in has to be completed here
+      wait_job();
+      queue_end = queue_tail;
+      if (ahead_len < count)
+      {
+         calc_frame(sound_buffer + ahead_len, count - ahead_len);
+         ahead_len = count;
+      }
+      memcpy(buf, sound_buffer, count*2);
+      ahead_len -= count;
+      memmove(sound_buffer, sound_buffer + count, ahead_len*2);
+
+      // Start the frame that ended, which fills up the lead-in again.
+      // The worker only applies the writes queued up to now, so the
+      // samples don't depend on how far the emulation got meanwhile
+      int len = output_freq / CALC_FREQ - ahead_len;
+      if (len > 0)
+      {
+         slock_lock(job_lock);
+         job_buf    = sound_buffer + ahead_len;
+         job_len    = len;
+         ahead_len += len;
+         scond_signal(job_cond);
+         slock_unlock(job_lock);
+      }
+      return;
+   }
+#endif
+
+   queue_end = queue_tail;
+   calc_frame(buf, count);
 }
 
 /*
@@ -1349,9 +1942,14 @@ void MOS6581::open_close_renderer(int old_type, int new_type)
 
    // Create new renderer
    if (new_type == SIDTYPE_DIGITAL)
-      the_renderer = new DigitalRenderer(the_c64);
+      the_renderer = new DigitalRenderer(the_c64, false);
+   else if (new_type == SIDTYPE_ACCURATE)
+      the_renderer = new DigitalRenderer(the_c64, true);
+   else if (new_type == SIDTYPE_FAST)
+      the_renderer = new FastRenderer(the_c64);
    else
       the_renderer = NULL;
+   renderer_type = new_type;
 
    // Stuff the current register values into the new renderer
    if (the_renderer)
@@ -29,6 +29,13 @@
 #undef EMUL_MOS8580
 
 
+// Timing shared by the renderers
+const uint32 SID_FREQ = 985248;		// SID frequency in Hz
+const uint32 CALC_FREQ = 50;		// Frequency at which the sound buffer is filled in Hz (should be 50Hz)
+const uint32 MIN_OUTPUT_FREQ = 8000;	// Range of output sample frequencies
+const uint32 MAX_OUTPUT_FREQ = 96000;
+
+
 class Prefs;
 class C64;
 class SIDRenderer;
@@ -37,7 +44,7 @@ struct MOS6581State;
 // Class for administrative functions
 class MOS6581 {
 public:
-	MOS6581(C64 *c64);
+	MOS6581(C64 *c64, bool extra = false);
 	~MOS6581();
 
 	void Reset(void);
@@ -49,14 +56,22 @@ public:
 	void GetState(MOS6581State *ss);
 	void SetState(MOS6581State *ss);
 	void EmulateLine(void);
+	void VBlank(int16 *buf, int count);
+	bool Active(void) { return active; }
+
+	static void Mix(int16 *out, const int16 *sid1, const int16 *sid2, const int16 *sid3, int count);
 
 private:
 	void open_close_renderer(int old_type, int new_type);
+	void activate(void);
 
 	C64 *the_c64;				// Pointer to C64 object
 	SIDRenderer *the_renderer;	// Pointer to current renderer
+	int renderer_type;			// SIDType the_renderer was opened for
+	bool active;				// Flag: Renderer opened (extra SIDs: after the first write)
 	uint8 regs[32];				// Copies of the 25 write-only SID registers
 	uint8 last_sid_byte;		// Last value written to SID
+	uint32 rand_seed;			// Random numbers for the voice 3 readout
 };
 
 
@@ -66,6 +81,7 @@ public:
 	virtual ~SIDRenderer() {}
 	virtual void Reset(void)=0;
 	virtual void EmulateLine(void)=0;
+	virtual void VBlank(int16 *buf, int count)=0;
 	virtual void WriteRegister(uint16 adr, uint8 byte)=0;
 	virtual void NewPrefs(Prefs *prefs)=0;
 	virtual void Pause(void)=0;
@@ -111,17 +127,6 @@ struct MOS6581State {
 };
 
 
-/*
- * Fill buffer (for Unix sound routines), sample volume (for sampled voice)
- */
-
-inline void MOS6581::EmulateLine(void)
-{
-	if (the_renderer != NULL)
-		the_renderer->EmulateLine();
-}
-
-
 /*
  *  Read from register
  */
@@ -137,7 +142,8 @@ inline uint8 MOS6581::ReadRegister(uint16 adr)
 	// Voice 3 oscillator/EG readout
 	if (adr == 0x1b || adr == 0x1c) {
 		last_sid_byte = 0;
-		return rand();
+		rand_seed = rand_seed * 1103515245 + 12345;
+		return rand_seed >> 16;
 	}
 
 	// Write-only register: Return last value written to SID
@@ -156,6 +162,8 @@ inline void MOS6581::WriteRegister(uint16 adr, uint8 byte)
 
 	if (the_renderer != NULL)
 		the_renderer->WriteRegister(adr, byte);
+	else if (!active)
+		activate();
 }
 
 #endif
@@ -0,0 +1,486 @@
+/*
+ *  SID_Fast.cpp - Fast SID renderer for slow machines (SIDTYPE_FAST)
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Notes:
+ * ------
+ *
+ *  - The samples are calculated directly at the output rate, a raster
+ *    line at a time, so there is no Resampler and no write queue.
+ *    Register writes take effect at the next raster line. VBlank()
+ *    hands out the number of samples the C64 class counted, the lines
+ *    before an extra SID opened the renderer are calculated at the end
+ *    of the frame.
+ *  - Integer arithmetic only. The waveforms are 12 bit values like on
+ *    the real chip, combined waveforms are the AND of their parts.
+ *  - The filter is a state variable filter with linear approximations
+ *    of the cutoff frequency and resonance.
+ *
+ * Incompatibilities:
+ * ------------------
+ *
+ *  - The oscillators are only looked at once per sample: Hard sync
+ *    is late and pulse/sawtooth alias at high frequencies
+ *  - The cutoff frequency is limited to a fifth of the output rate
+ */
+
+#include <string.h>
+
+#include "sysdeps.h"
+
+#include "SID_Fast.h"
+#include "Prefs.h"
+#include "C64.h"
+#include "VIC.h"
+
+// EG states
+enum {
+	EG_IDLE,
+	EG_ATTACK,
+	EG_DECAY,
+	EG_RELEASE
+};
+
+// Voice that syncs/ring modulates each voice
+static const int SyncSource[3] = {2, 0, 1};
+
+const uint32 EG_MAX = 0xff0000;			// Maximum envelope level, 8.16 fixed
+const int32 FILTER_MAX_W = 5324;		// Limit for f_w, keeps the filter stable (1.3, about rate/5)
+
+const uint16 FastRenderer::EGPeriod[16] = {
+	9, 32, 63, 95, 149, 220, 267, 313,
+	392, 977, 1954, 3126, 3906, 11720, 19531, 31251
+};
+
+
+/*
+ *  Noise waveform from the shift register
+ */
+
+static inline uint32 noise_output(uint32 lfsr)
+{
+	return ((lfsr >> 11) & 0x800) | ((lfsr >> 10) & 0x400) | ((lfsr >> 7) & 0x200)
+		| ((lfsr >> 5) & 0x100) | ((lfsr >> 4) & 0x080) | ((lfsr >> 1) & 0x040)
+		| ((lfsr << 1) & 0x020) | ((lfsr << 2) & 0x010);
+}
+
+
+/*
+ *  Exponential approximation of decay/release: The step rate is
+ *  divided at certain envelope levels
+ */
+
+static inline int eg_shift(uint32 level)
+{
+	level >>= 16;
+	if (level >= 0x5d)
+		return 0;
+	if (level >= 0x36)
+		return 1;
+	if (level >= 0x1a)
+		return 2;
+	if (level >= 0x0e)
+		return 3;
+	if (level >= 0x06)
+		return 4;
+	return 5;
+}
+
+
+/*
+ *  Constructor
+ */
+
+FastRenderer::FastRenderer(C64 *c64) : the_c64(c64)
+{
+	sound_buffer = NULL;
+	output_freq  = 0;
+	set_output_freq(the_c64->MachinePrefs->SampleRate);
+	Reset();
+}
+
+
+/*
+ *  Destructor
+ */
+
+FastRenderer::~FastRenderer()
+{
+	delete[] sound_buffer;
+}
+
+
+/*
+ *  Reset emulation
+ */
+
+void FastRenderer::Reset(void)
+{
+	int v;
+
+	memset(voice, 0, sizeof(voice));
+	for (v = 0; v < 3; v++)
+	{
+		voice[v].lfsr     = 0x7ffff8;
+		voice[v].eg_state = EG_IDLE;
+		calc_eg_rates(v);
+	}
+
+	volume   = 0;
+	mode_vol = res_filt = 0;
+	f_freq   = 0;
+	f_lp     = f_bp = 0;
+	calc_filter();
+}
+
+
+/*
+ *  Write to register, takes effect at the next raster line
+ */
+
+void FastRenderer::WriteRegister(uint16 adr, uint8 byte)
+{
+	int v = adr / 7;	// Voice number
+	FRVoice *vc = &voice[v];
+
+	switch (adr)
+	{
+		case 0: case 7: case 14:
+			vc->freq = (vc->freq & 0xff00) | byte;
+			vc->add  = (uint32)(((uint64)vc->freq * SID_FREQ) / output_freq);
+			break;
+
+		case 1: case 8: case 15:
+			vc->freq = (vc->freq & 0xff) | (byte << 8);
+			vc->add  = (uint32)(((uint64)vc->freq * SID_FREQ) / output_freq);
+			break;
+
+		case 2: case 9: case 16:
+			vc->pw = (vc->pw & 0x0f00) | byte;
+			break;
+
+		case 3: case 10: case 17:
+			vc->pw = (vc->pw & 0xff) | ((byte & 0xf) << 8);
+			break;
+
+		case 4: case 11: case 18:
+			if ((byte & 1) && !(vc->ctrl & 1))			// Gate turned on
+				vc->eg_state = EG_ATTACK;
+			else if (!(byte & 1) && (vc->ctrl & 1))		// Gate turned off
+			{
+				if (vc->eg_state != EG_IDLE)
+					vc->eg_state = EG_RELEASE;
+			}
+			if (byte & 8)
+				vc->count = 0;
+			vc->ctrl = byte;
+			break;
+
+		case 5: case 12: case 19:
+			vc->ad = byte;
+			calc_eg_rates(v);
+			break;
+
+		case 6: case 13: case 20:
+			vc->sr = byte;
+			calc_eg_rates(v);
+			break;
+
+		case 21:
+			f_freq = (f_freq & 0x7f8) | (byte & 7);
+			calc_filter();
+			break;
+
+		case 22:
+			f_freq = (f_freq & 7) | (byte << 3);
+			calc_filter();
+			break;
+
+		case 23:
+			res_filt = byte;
+			calc_filter();
+			break;
+
+		case 24:
+			mode_vol = byte;
+			volume   = byte & 0xf;
+			break;
+	}
+}
+
+
+/*
+ *  Preferences may have changed, SIDFilters is read for every line
+ */
+
+void FastRenderer::NewPrefs(Prefs *prefs)
+{
+}
+
+
+/*
+ *  Pause/resume sound output
+ */
+
+void FastRenderer::Pause(void)
+{
+}
+
+void FastRenderer::Resume(void)
+{
+}
+
+
+/*
+ *  Set output sample frequency, one buffer holds a frame
+ */
+
+void FastRenderer::set_output_freq(int freq)
+{
+	int v;
+
+	prefs_freq = freq;
+	if (freq < (int)MIN_OUTPUT_FREQ)
+		freq = MIN_OUTPUT_FREQ;
+	else if (freq > (int)MAX_OUTPUT_FREQ)
+		freq = MAX_OUTPUT_FREQ;
+
+	output_freq  = freq;
+	sndbufsize   = freq / CALC_FREQ + 1;
+	delete[] sound_buffer;
+	sound_buffer = new int16[sndbufsize*2];
+	divisor      = 0;
+	to_output    = 0;
+	buffer_pos   = 0;
+
+	// Everything per sample depends on the rate
+	for (v = 0; v < 3; v++)
+	{
+		voice[v].add = (uint32)(((uint64)voice[v].freq * SID_FREQ) / output_freq);
+		calc_eg_rates(v);
+	}
+	calc_filter();
+}
+
+
+/*
+ *  Envelope level changes per sample from the A/D/S/R values of a voice
+ */
+
+void FastRenderer::calc_eg_rates(int v)
+{
+	FRVoice *vc = &voice[v];
+	uint64 step = (uint64)SID_FREQ << 16;	// One step per period, in 8.16 fixed
+
+	vc->a_add   = (uint32)(step / ((uint64)EGPeriod[vc->ad >> 4] * output_freq));
+	vc->d_sub   = (uint32)(step / ((uint64)EGPeriod[vc->ad & 0xf] * output_freq));
+	vc->r_sub   = (uint32)(step / ((uint64)EGPeriod[vc->sr & 0xf] * output_freq));
+	vc->s_level = ((vc->sr >> 4) * 0x11) << 16;
+}
+
+
+/*
+ *  Filter coefficients from cutoff and resonance
+ */
+
+void FastRenderer::calc_filter(void)
+{
+	// Cutoff frequency in Hz, about 30..12000 Hz on a 6581
+	uint32 fc = 30 + f_freq * 29 / 5;
+
+	// w = 2 * pi * fc / rate
+	f_w = (int32)(((uint64)fc * 25736) / output_freq);
+	if (f_w > FILTER_MAX_W)
+		f_w = FILTER_MAX_W;
+
+	// 1/Q from 1.41 (no resonance) down to 0.59
+	f_q = (4096 * 1024) / (724 + (res_filt >> 4) * 68);
+}
+
+
+/*
+ *  Calculate count samples with the current register values
+ */
+
+void FastRenderer::calc_samples(int16 *buf, int count)
+{
+	bool filters = the_c64->MachinePrefs->SIDFilters;
+	uint8 filt   = filters ? res_filt & 7 : 0;
+	uint8 mode   = mode_vol >> 4;		// LP, BP, HP, voice 3 off
+	int32 digi   = ((int32)volume * 0x1111 - 0x8000) << 2;	// Sampled voice
+	int v;
+
+	while (count--)
+	{
+		int32 direct = 0, filt_in = 0;
+		uint32 carry = 0;
+
+		// Oscillators
+		for (v = 0; v < 3; v++)
+		{
+			FRVoice *vc = &voice[v];
+			if (vc->ctrl & 8)
+				continue;
+
+			uint32 c = vc->count + vc->add;
+			if (vc->ctrl & 0x80)
+			{
+				// Noise is clocked by bit 19 going high
+				int clocks = (int)(((c + 0x80000) >> 20) - ((vc->count + 0x80000) >> 20));
+				while (clocks-- > 0)
+					vc->lfsr = ((vc->lfsr << 1) | (((vc->lfsr >> 22) ^ (vc->lfsr >> 17)) & 1)) & 0x7fffff;
+			}
+			if (c > 0xffffff)
+				carry |= 1 << v;
+			vc->count = c & 0xffffff;
+		}
+
+		// Hard sync
+		for (v = 0; v < 3; v++)
+			if ((voice[v].ctrl & 2) && (carry & (1 << SyncSource[v])))
+				voice[v].count = 0;
+
+		for (v = 0; v < 3; v++)
+		{
+			FRVoice *vc = &voice[v];
+
+			// Envelope generator
+			uint32 level = vc->eg_level;
+			switch (vc->eg_state)
+			{
+				case EG_ATTACK:
+					level += vc->a_add;
+					if (level >= EG_MAX)
+					{
+						level = EG_MAX;
+						vc->eg_state = EG_DECAY;
+					}
+					break;
+				case EG_DECAY:
+					if (level > vc->s_level)
+					{
+						level -= vc->d_sub >> eg_shift(level);
+						if (level < vc->s_level || level > EG_MAX)
+							level = vc->s_level;
+					}
+					break;
+				case EG_RELEASE:
+					level -= vc->r_sub >> eg_shift(level);
+					if (level > EG_MAX)
+					{
+						level = 0;
+						vc->eg_state = EG_IDLE;
+					}
+					break;
+			}
+			vc->eg_level = level;
+
+			// Waveform generator
+			uint8 wave = vc->ctrl >> 4;
+			if (wave == 0 || level == 0)
+				continue;
+
+			uint32 c = vc->count;
+			uint32 w = 0xfff;
+			if (wave & 1)
+			{
+				uint32 msb = c;
+				if (vc->ctrl & 4)
+					msb ^= voice[SyncSource[v]].count;
+				w &= ((msb & 0x800000 ? c ^ 0xffffff : c) >> 11) & 0xfff;
+			}
+			if (wave & 2)
+				w &= c >> 12;
+			if (wave & 4)
+				w &= ((vc->ctrl & 8) || (c >> 12) >= vc->pw) ? 0xfff : 0;
+			if (wave & 8)
+				w &= noise_output(vc->lfsr);
+
+			int32 out = ((int32)w - 0x800) * (int32)(level >> 16) >> 6;
+			if (filt & (1 << v))
+				filt_in += out;
+			else if (v != 2 || !(mode & 8))
+				direct += out;
+		}
+
+		// Filter
+		if (filters)
+		{
+			int32 hp = filt_in - f_lp - ((f_q * f_bp) >> 12);
+			f_bp += (f_w * hp) >> 12;
+			f_lp += (f_w * f_bp) >> 12;
+			if (mode & 1)
+				direct += f_lp;
+			if (mode & 2)
+				direct += f_bp;
+			if (mode & 4)
+				direct += hp;
+		}
+
+		// Master volume
+		int32 sample = (direct * volume + digi) >> 4;
+		if (sample > 32767)
+			sample = 32767;
+		else if (sample < -32768)
+			sample = -32768;
+		*buf++ = sample;
+	}
+}
+
+
+/*
+ *  Calculate the samples of a raster line, the fraction of a sample
+ *  is carried over to the next line
+ */
+
+void FastRenderer::EmulateLine(void)
+{
+	// Output frequency changed in the prefs?
+	if (prefs_freq != the_c64->MachinePrefs->SampleRate)
+		set_output_freq(the_c64->MachinePrefs->SampleRate);
+
+	divisor += output_freq;
+	while (divisor >= 0)
+		divisor -= TOTAL_RASTERS*SCREEN_FREQ, to_output++;
+
+	if (to_output > sndbufsize*2 - buffer_pos)
+		to_output = sndbufsize*2 - buffer_pos;
+	calc_samples(sound_buffer + buffer_pos, to_output);
+	buffer_pos += to_output;
+	to_output   = 0;
+}
+
+
+/*
+ *  Hand count samples of the frame that ended to the C64
+ */
+
+void FastRenderer::VBlank(int16 *buf, int count)
+{
+	if (buffer_pos < count)
+	{
+		calc_samples(sound_buffer + buffer_pos, count - buffer_pos);
+		buffer_pos = count;
+	}
+
+	memcpy(buf, sound_buffer, count*2);
+	buffer_pos -= count;
+	memmove(sound_buffer, sound_buffer + count, buffer_pos*2);
+}
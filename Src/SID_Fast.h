@@ -0,0 +1,87 @@
+/*
+ *  SID_Fast.h - Fast SID renderer for slow machines (SIDTYPE_FAST)
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _SID_FAST_H
+#define _SID_FAST_H
+
+#include "SID.h"
+
+
+// Data for one voice
+struct FRVoice {
+	uint32 count;		// 24 bit oscillator
+	uint32 add;			// Added to count for each sample
+	uint32 lfsr;		// 23 bit noise shift register
+	uint16 freq;		// SID frequency value
+	uint16 pw;			// Pulse width (12 bits)
+	uint8 ctrl;			// Control register (waveform, test, ring, sync, gate)
+	uint8 eg_state;		// Envelope generator state
+	uint32 eg_level;	// Envelope level, 8.16 fixed
+	uint32 a_add;		// Envelope level change per sample in attack,
+	uint32 d_sub;		//  decay
+	uint32 s_level;		//  and sustain/release
+	uint32 r_sub;
+	uint8 ad, sr;		// A/D and S/R register values
+};
+
+// Renderer class
+class FastRenderer : public SIDRenderer {
+public:
+	FastRenderer(C64 *c64);
+	virtual ~FastRenderer();
+
+	virtual void Reset(void);
+	virtual void EmulateLine(void);
+	virtual void VBlank(int16 *buf, int count);
+	virtual void WriteRegister(uint16 adr, uint8 byte);
+	virtual void NewPrefs(Prefs *prefs);
+	virtual void Pause(void);
+	virtual void Resume(void);
+
+private:
+	void set_output_freq(int freq);
+	void calc_eg_rates(int v);
+	void calc_filter(void);
+	void calc_samples(int16 *buf, int count);
+
+	C64 *the_c64;				// Pointer to C64 object
+
+	static const uint16 EGPeriod[16];	// SID clocks per envelope step for all A/D/R settings
+
+	FRVoice voice[3];			// Data for 3 voices
+	uint8 volume;				// Master volume
+	uint8 mode_vol;				// Register 24 (filter mode, voice 3 off, volume)
+	uint8 res_filt;				// Register 23 (resonance, filter routing)
+	uint16 f_freq;				// Filter cutoff (11 bits)
+
+	int32 f_w;					// State variable filter frequency, 4.12 fixed
+	int32 f_q;					// State variable filter damping, 4.12 fixed
+	int32 f_lp, f_bp;			// State variable filter state
+
+	int prefs_freq;				// SampleRate of the prefs output_freq is set from
+	uint32 output_freq;			// Output sample frequency in Hz
+	int sndbufsize;				// Samples per frame, rounded up
+	int16 *sound_buffer;
+	int divisor;				// Samples per line in EmulateLine()
+	int to_output;				// Samples of the current line
+	int buffer_pos;				// Samples calculated for this frame in sound_buffer
+};
+
+#endif
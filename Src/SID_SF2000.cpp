@@ -1,418 +0,0 @@
-/*
- * SID_SF2000.cpp - Optimized SID implementation for SF2000
- */
-
-#include "SID_SF2000.h"
-#include "C64.h"
-#include <math.h>
-#include <string.h>
-
-// Static lookup tables
-SIDTables MOS6581_SF2000::tables;
-bool MOS6581_SF2000::tables_initialized = false;
-
-MOS6581_SF2000::MOS6581_SF2000(C64 *c64) : MOS6581(c64) {
-    if (!tables_initialized) {
-        InitializeTables();
-        tables_initialized = true;
-    }
-    
-    // Initialize voices
-    memset(voices, 0, sizeof(voices));
-    
-    // Set default audio parameters
-    sample_rate = SF2000_SAMPLE_RATE;
-    cycles_per_sample = SID_CYCLES_PER_SAMPLE;
-    cycle_counter = 0;
-    
-    // Initialize filter
-    filter_enabled = false;
-    filter_cutoff = 0;
-    filter_resonance = 0;
-    filter_mode = 0;
-    filter_output = 0;
-    
-    // Initialize performance counters
-    fast_samples = 0;
-    slow_samples = 0;
-    
-    // Initialize master volume
-    master_volume = 15;
-    
-    InitializeFastSID();
-}
-
-MOS6581_SF2000::~MOS6581_SF2000() {
-    // Nothing to clean up
-}
-
-void MOS6581_SF2000::InitializeTables() {
-    // Initialize triangle waveform lookup table
-    for (int i = 0; i < 4096; i++) {
-        if (i < 2048) {
-            tables.triangle_table[i] = (i - 1024) * 16;
-        } else {
-            tables.triangle_table[i] = (3072 - i) * 16;
-        }
-    }
-    
-    // Initialize sawtooth waveform lookup table
-    for (int i = 0; i < 4096; i++) {
-        tables.sawtooth_table[i] = (i - 2048) * 8;
-    }
-    
-    // Initialize pulse waveform lookup table (for 50% duty cycle)
-    for (int i = 0; i < 4096; i++) {
-        tables.pulse_table[i] = (i < 2048) ? -16384 : 16384;
-    }
-    
-    // Initialize noise table with pseudo-random values
-    uint32 lfsr = 0x7FFFF8;  // Initial LFSR value
-    for (int i = 0; i < 1024; i++) {
-        // Simple LFSR for noise generation
-        uint32 bit = ((lfsr >> 22) ^ (lfsr >> 17)) & 1;
-        lfsr = ((lfsr << 1) | bit) & 0x7FFFFF;
-        tables.noise_table[i] = (lfsr & 0xFFFF);
-    }
-    
-    // Initialize frequency to phase increment lookup table
-    for (int i = 0; i < 0x10000; i++) {
-        // Convert SID frequency to phase increment
-        // SID frequency = phase_increment * sample_rate / (16777216)
-        double frequency_hz = (double)i * 0.0596;  // Approximate SID frequency scaling
-        double phase_inc = (frequency_hz * 16777216.0) / SF2000_SAMPLE_RATE;
-        tables.frequency_table[i] = (uint32)phase_inc;
-    }
-    
-    // Initialize envelope rate table
-    for (int i = 0; i < 256; i++) {
-        // Exponential envelope rates (simplified)
-        double rate = pow(2.0, (i & 0x0F) / 2.0);
-        tables.envelope_table[i] = (uint16)(rate * 64);
-    }
-}
-
-void MOS6581_SF2000::InitializeFastSID() {
-    // Initialize all voices to silent state
-    for (int i = 0; i < SID_VOICES; i++) {
-        voices[i].frequency = 0;
-        voices[i].phase_accumulator = 0;
-        voices[i].phase_increment = 0;
-        voices[i].waveform = WAVE_NONE;
-        voices[i].pulse_width = 0x800;  // 50% duty cycle
-        voices[i].envelope_state = 0;   // Attack
-        voices[i].envelope_level = 0;
-        voices[i].gate = false;
-        voices[i].output = 0;
-        voices[i].active = false;
-    }
-}
-
-void MOS6581_SF2000::SetSampleRate(int rate) {
-    sample_rate = rate;
-    cycles_per_sample = 985248 / rate;  // C64 clock cycles per sample
-    
-    // Recalculate frequency table for new sample rate
-    for (int i = 0; i < 0x10000; i++) {
-        double frequency_hz = (double)i * 0.0596;
-        double phase_inc = (frequency_hz * 16777216.0) / sample_rate;
-        tables.frequency_table[i] = (uint32)phase_inc;
-    }
-}
-
-void MOS6581_SF2000::WriteRegister(uint16 adr, uint8 byte) {
-    int voice = (adr - 0xD400) / 7;
-    int reg = (adr - 0xD400) % 7;
-    
-    if (voice < SID_VOICES) {
-        switch (reg) {
-            case 0:  // Frequency low
-                voices[voice].frequency = (voices[voice].frequency & 0xFF00) | byte;
-                UpdateVoiceFrequency(voice);
-                break;
-                
-            case 1:  // Frequency high
-                voices[voice].frequency = (voices[voice].frequency & 0x00FF) | (byte << 8);
-                UpdateVoiceFrequency(voice);
-                break;
-                
-            case 2:  // Pulse width low
-                voices[voice].pulse_width = (voices[voice].pulse_width & 0x0F00) | byte;
-                break;
-                
-            case 3:  // Pulse width high
-                voices[voice].pulse_width = (voices[voice].pulse_width & 0x00FF) | ((byte & 0x0F) << 8);
-                break;
-                
-            case 4: { // Control register
-                voices[voice].waveform = byte & 0xF0;
-                voices[voice].test = byte & 0x08;
-                voices[voice].ring_mod = byte & 0x04;
-                voices[voice].sync = byte & 0x02;
-                
-                // Handle gate bit
-                bool new_gate = byte & 0x01;
-                if (new_gate && !voices[voice].gate) {
-                    // Gate on - start attack
-                    voices[voice].envelope_state = 0;
-                    voices[voice].active = true;
-                } else if (!new_gate && voices[voice].gate) {
-                    // Gate off - start release
-                    voices[voice].envelope_state = 3;
-                }
-                voices[voice].gate = new_gate;
-                
-                UpdateVoiceWaveform(voice);
-                break;
-            }
-                
-            case 5:  // Attack/Decay
-                voices[voice].attack = (byte >> 4) & 0x0F;
-                voices[voice].decay = byte & 0x0F;
-                break;
-                
-            case 6:  // Sustain/Release
-                voices[voice].sustain = (byte >> 4) & 0x0F;
-                voices[voice].release = byte & 0x0F;
-                break;
-        }
-    } else {
-        // Filter and master volume registers
-        switch (adr - 0xD415) {
-            case 0:  // Filter cutoff low
-                filter_cutoff = (filter_cutoff & 0xF8) | (byte & 0x07);
-                break;
-                
-            case 1:  // Filter cutoff high
-                filter_cutoff = (filter_cutoff & 0x07) | (byte & 0xF8);
-                break;
-                
-            case 2:  // Filter resonance and routing
-                filter_resonance = (byte >> 4) & 0x0F;
-                // Filter routing bits...
-                break;
-                
-            case 3:  // Filter mode and master volume
-                filter_mode = (byte >> 4) & 0x07;
-                master_volume = byte & 0x0F;
-                filter_enabled = (filter_mode != 0);
-                break;
-        }
-    }
-    
-    // Call original for compatibility
-    MOS6581::WriteRegister(adr, byte);
-}
-
-uint8 MOS6581_SF2000::ReadRegister(uint16 adr) {
-    // Use original read implementation
-    return MOS6581::ReadRegister(adr);
-}
-
-void MOS6581_SF2000::EmulateLine() {
-    cycle_counter += 63;  // One raster line = 63 cycles
-    
-    // Generate audio samples if enough cycles have passed
-    while (cycle_counter >= cycles_per_sample) {
-        cycle_counter -= cycles_per_sample;
-        
-        // Mix all three voices
-        int32 mixed_output = 0;
-        
-        for (int i = 0; i < SID_VOICES; i++) {
-            if (voices[i].active) {
-                // Update voice
-                UpdateVoiceEnvelope(i);
-                
-                // Generate waveform sample
-                int16 voice_output = 0;
-                
-                switch (voices[i].waveform & 0xF0) {
-                    case WAVE_TRIANGLE:
-                        voice_output = GenerateTriangle(voices[i]);
-                        break;
-                    case WAVE_SAWTOOTH:
-                        voice_output = GenerateSawtooth(voices[i]);
-                        break;
-                    case WAVE_PULSE:
-                        voice_output = GeneratePulse(voices[i]);
-                        break;
-                    case WAVE_NOISE:
-                        voice_output = GenerateNoise(voices[i]);
-                        break;
-                    default:
-                        voice_output = 0;
-                        break;
-                }
-                
-                // Apply envelope
-                voice_output = ProcessEnvelope(voices[i], voice_output);
-                voices[i].output = voice_output;
-                
-                // Add to mix
-                mixed_output += voice_output;
-            }
-        }
-        
-        // Apply master volume
-        mixed_output = (mixed_output * master_volume) / 15;
-        
-        // Apply filter if enabled (simplified)
-        if (filter_enabled) {
-            mixed_output = ProcessFilter(mixed_output);
-        }
-        
-        // Clamp to 16-bit range
-        int16 final_sample = ClampSample(mixed_output);
-        
-        // Store sample in audio buffer (this would be connected to libretro audio)
-        // audio_buffer[audio_buffer_pos++] = final_sample;
-        
-        fast_samples++;
-    }
-}
-
-void MOS6581_SF2000::GenerateSamples(int16* buffer, int num_samples) {
-    for (int sample = 0; sample < num_samples; sample++) {
-        // Mix all three voices
-        int32 mixed_output = 0;
-        
-        for (int i = 0; i < SID_VOICES; i++) {
-            if (voices[i].active || voices[i].envelope_level > 0) {
-                // Update voice
-                UpdateVoiceEnvelope(i);
-                
-                // Generate waveform sample
-                int16 voice_output = 0;
-                
-                if (voices[i].waveform != WAVE_NONE) {
-                    switch (voices[i].waveform & 0xF0) {
-                        case WAVE_TRIANGLE:
-                            voice_output = GenerateTriangle(voices[i]);
-                            break;
-                        case WAVE_SAWTOOTH:
-                            voice_output = GenerateSawtooth(voices[i]);
-                            break;
-                        case WAVE_PULSE:
-                            voice_output = GeneratePulse(voices[i]);
-                            break;
-                        case WAVE_NOISE:
-                            voice_output = GenerateNoise(voices[i]);
-                            break;
-                    }
-                }
-                
-                // Apply envelope
-                voice_output = ProcessEnvelope(voices[i], voice_output);
-                mixed_output += voice_output;
-            }
-        }
-        
-        // Apply master volume
-        mixed_output = (mixed_output * master_volume) / 15;
-        
-        // Apply filter if enabled
-        if (filter_enabled) {
-            mixed_output = ProcessFilter(mixed_output);
-        }
-        
-        // Store final sample
-        buffer[sample] = ClampSample(mixed_output);
-    }
-}
-
-// Fast waveform generators using lookup tables
-int16 MOS6581_SF2000::GenerateTriangle(SIDVoice& voice) {
-    voice.phase_accumulator += voice.phase_increment;
-    uint32 index = (voice.phase_accumulator >> 16) & 0xFFF;
-    return tables.triangle_table[index];
-}
-
-int16 MOS6581_SF2000::GenerateSawtooth(SIDVoice& voice) {
-    voice.phase_accumulator += voice.phase_increment;
-    uint32 index = (voice.phase_accumulator >> 16) & 0xFFF;
-    return tables.sawtooth_table[index];
-}
-
-int16 MOS6581_SF2000::GeneratePulse(SIDVoice& voice) {
-    voice.phase_accumulator += voice.phase_increment;
-    uint32 phase = (voice.phase_accumulator >> 16) & 0xFFF;
-    return (phase < voice.pulse_width) ? 16384 : -16384;
-}
-
-int16 MOS6581_SF2000::GenerateNoise(SIDVoice& voice) {
-    voice.phase_accumulator += voice.phase_increment;
-    if ((voice.phase_accumulator >> 16) & 0x80) {
-        uint32 index = (voice.phase_accumulator >> 8) & 0x3FF;
-        return (int16)(tables.noise_table[index] - 32768);
-    }
-    return voice.output;  // Hold previous value
-}
-
-int16 MOS6581_SF2000::ProcessEnvelope(SIDVoice& voice, int16 sample) {
-    // Apply envelope to sample
-    int32 result = (sample * voice.envelope_level) >> 8;
-    return ClampSample(result);
-}
-
-int16 MOS6581_SF2000::ProcessFilter(int16 sample) {
-    // Very simplified filter implementation for SF2000
-    // Just a simple low-pass filter
-    filter_output = (filter_output * 3 + sample) >> 2;
-    return filter_output;
-}
-
-void MOS6581_SF2000::UpdateVoiceFrequency(int voice) {
-    voices[voice].phase_increment = CalculatePhaseIncrement(voices[voice].frequency);
-}
-
-void MOS6581_SF2000::UpdateVoiceWaveform(int voice) {
-    // Update waveform-specific parameters
-    if (voices[voice].waveform == WAVE_NONE) {
-        voices[voice].active = false;
-    }
-}
-
-void MOS6581_SF2000::UpdateVoiceEnvelope(int voice) {
-    SIDVoice& v = voices[voice];
-    
-    // Update envelope based on current state
-    switch (v.envelope_state) {
-        case 0:  // Attack
-            if (v.gate) {
-                v.envelope_level += GetEnvelopeRate(v.attack);
-                if (v.envelope_level >= 0xFF00) {
-                    v.envelope_level = 0xFF00;
-                    v.envelope_state = 1;  // Move to decay
-                }
-            }
-            break;
-            
-        case 1:  // Decay
-            if (v.gate) {
-                uint16 sustain_level = (v.sustain << 12);
-                if (v.envelope_level > sustain_level) {
-                    v.envelope_level -= GetEnvelopeRate(v.decay);
-                    if (v.envelope_level <= sustain_level) {
-                        v.envelope_level = sustain_level;
-                        v.envelope_state = 2;  // Move to sustain
-                    }
-                }
-            }
-            break;
-            
-        case 2:  // Sustain
-            // Hold sustain level while gate is on
-            break;
-            
-        case 3:  // Release
-            if (v.envelope_level > 0) {
-                v.envelope_level -= GetEnvelopeRate(v.release);
-                if (v.envelope_level <= 0) {
-                    v.envelope_level = 0;
-                    v.active = false;
-                }
-            }
-            break;
-    }
-}
\ No newline at end of file
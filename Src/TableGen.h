@@ -0,0 +1,54 @@
+/*
+ *  TableGen.h - Generate constant lookup tables at compile time
+ *
+ *  Frodo (C) 1994-1997,2002-2009 Christian Bauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _TABLEGEN_H
+#define _TABLEGEN_H
+
+/*
+ *  TABLE_n(F, i) expands to the initializer list F(i), F(i+1), ...
+ *  F(i+n-1), where F is a function-like macro that calculates one
+ *  entry with a constant expression. This works with any C++ version
+ *  and puts tables that don't depend on run-time data into .rodata:
+ *
+ *  #define SQUARE(i) ((i) * (i))
+ *  static const uint16 SquareTable[256] = { TABLE_256(SQUARE, 0) };
+ */
+
+#define TABLE_4(F, i)    F(i), F((i)+1), F((i)+2), F((i)+3)
+#define TABLE_16(F, i)   TABLE_4(F, i), TABLE_4(F, (i)+4), TABLE_4(F, (i)+8), TABLE_4(F, (i)+12)
+#define TABLE_64(F, i)   TABLE_16(F, i), TABLE_16(F, (i)+16), TABLE_16(F, (i)+32), TABLE_16(F, (i)+48)
+#define TABLE_256(F, i)  TABLE_64(F, i), TABLE_64(F, (i)+64), TABLE_64(F, (i)+128), TABLE_64(F, (i)+192)
+#define TABLE_512(F, i)  TABLE_256(F, i), TABLE_256(F, (i)+256)
+#define TABLE_1024(F, i) TABLE_256(F, i), TABLE_256(F, (i)+256), TABLE_256(F, (i)+512), TABLE_256(F, (i)+768)
+#define TABLE_4096(F, i) TABLE_1024(F, i), TABLE_1024(F, (i)+1024), TABLE_1024(F, (i)+2048), TABLE_1024(F, (i)+3072)
+#define TABLE_8192(F, i) TABLE_4096(F, i), TABLE_4096(F, (i)+4096)
+
+/*
+ *  BIT_MASK_8(i) is the entry for table[256][8] in which byte n is
+ *  0xff if bit 7-n of the index is set, so 8 pixels of a graphics
+ *  byte can be blended with masks at once
+ */
+
+#define BIT_MASK_BYTE(i, b) (((i) & (b)) ? 0xff : 0x00)
+#define BIT_MASK_8(i) { BIT_MASK_BYTE(i, 0x80), BIT_MASK_BYTE(i, 0x40), \
+	BIT_MASK_BYTE(i, 0x20), BIT_MASK_BYTE(i, 0x10), BIT_MASK_BYTE(i, 0x08), \
+	BIT_MASK_BYTE(i, 0x04), BIT_MASK_BYTE(i, 0x02), BIT_MASK_BYTE(i, 0x01) }
+
+#endif
@@ -35,9 +35,11 @@
  *    to a bitplane representation (two bit masks) for easier
  *    handling of priorities and collisions.
  *  - The sprite-sprite priority handling and collision
- *    detection is done in with the byte array spr_coll_buf[],
- *    that is used to keep track of which sprites are already
- *    visible at certain X positions.
+ *    detection is also done with bit masks, there is no pixel
+ *    buffer for it. Each sprite gets a 64 bit occupancy mask
+ *    for the line, and the masks of all sprites are compared
+ *    with each other before anything is painted, so every
+ *    pixel is only written once.
  *
  * Incompatibilities:
  * ------------------
@@ -59,11 +61,24 @@
 
 #include "sysdeps.h"
 
+// Define TEXT_COLOR_TABLE to render hires graphics through the old
+// 512 KB precomputed color table instead of the mask expansion
+#if !defined(TEXT_COLOR_TABLE)
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HIRES_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HIRES_SSE2 1
+#endif
+#endif
+
 #include "VIC.h"
 #include "C64.h"
 #include "CPUC64.h"
 #include "Display.h"
 #include "Prefs.h"
+#include "TableGen.h"
 
 
 // First and last displayed line
@@ -165,6 +180,7 @@ uint16 MultiExpTable[256] = {
 	0xFFA0, 0xFFA5, 0xFFAA, 0xFFAF, 0xFFF0, 0xFFF5, 0xFFFA, 0xFFFF
 };
 
+#ifdef TEXT_COLOR_TABLE
 static union
 {
    struct {
@@ -172,6 +188,10 @@ static union
    } a;
    uint32 b;
 } TextColorTable[16][16][256][2];
+#endif
+
+// Used to blend 8 hires graphics or sprite pixels at once
+static const uint8 TextMaskTable[256][8] = { TABLE_256(BIT_MASK_8, 0) };
 
 #ifdef GLOBAL_VARS
 static uint16 mc_color_lookup[4];
@@ -230,8 +250,7 @@ static int skip_counter;				// Counter for frame-skipping
 static uint16 mc[8];					   // Sprite data counters
 static uint8 sprite_on;					// 8 Flags: Sprite display/DMA active
 
-static uint8 spr_coll_buf[0x180];	// Buffer for sprite-sprite collisions and priorities
-static uint8 fore_mask_buf[0x180/8];// Foreground mask for sprite-graphics collisions and priorities
+static uint8 fore_mask_buf[0x180/8 + 8];// Foreground mask for sprite-graphics collisions and priorities
 
 static bool display_state;				// true: Display state, false: Idle state
 static bool border_on;					// Flag: Upper/lower border on
@@ -239,6 +258,8 @@ static bool border_40_col;				// Flag: 40 column border
 static bool frame_skipped;				// Flag: Frame is being skipped
 static uint8 bad_lines_enabled;		// Flag: Bad Lines enabled for this frame
 static bool lp_triggered;				// Flag: Lightpen was triggered in this frame
+
+static VICLineCache line_cache[LINE_CACHE_SIZE];	// Graphics of the displayed lines
 #endif
 
 
@@ -246,9 +267,11 @@ static bool lp_triggered;				// Flag: Lightpen was triggered in this frame
  *  Constructor: Initialize variables
  */
 
+#ifdef TEXT_COLOR_TABLE
 static void init_text_color_table(uint8 *colors)
 {
    unsigned i, j, k;
+
 	for (i = 0; i < 16; i++)
 		for (j = 0; j < 16; j++)
 			for (k = 0; k < 256; k++)
@@ -263,6 +286,52 @@ static void init_text_color_table(uint8 *colors)
             TextColorTable[i][j][k][1].a.d = colors[k & 1 ? i : j];
          }
 }
+#else
+/*
+ *  Expand one byte of hires graphics data to 8 chunky pixels
+ */
+
+static inline void expand_hires_char(uint8 *p, uint8 data, uint8 fg, uint8 bg)
+{
+	const uint64 ones = 0x0101010101010101ULL;
+	uint64 fg64 = fg * ones;
+	uint64 bg64 = bg * ones;
+	uint64 mask, pix;
+
+	memcpy(&mask, TextMaskTable[data], 8);
+	pix = bg64 ^ ((fg64 ^ bg64) & mask);
+	memcpy(p, &pix, 8);
+}
+
+
+/*
+ *  Expand the hires graphics data of two characters to 16 chunky pixels
+ */
+
+static inline void expand_hires_pair(uint8 *p, uint8 d0, uint8 d1, uint8 fg0, uint8 fg1, uint8 bg0, uint8 bg1)
+{
+#if defined(HIRES_NEON)
+	uint8x16_t mask = vcombine_u8(vld1_u8(TextMaskTable[d0]), vld1_u8(TextMaskTable[d1]));
+	uint8x16_t f    = vcombine_u8(vdup_n_u8(fg0), vdup_n_u8(fg1));
+	uint8x16_t b    = vcombine_u8(vdup_n_u8(bg0), vdup_n_u8(bg1));
+	vst1q_u8(p, vbslq_u8(mask, f, b));
+#elif defined(HIRES_SSE2)
+	const uint64 ones = 0x0101010101010101ULL;
+	uint64 m0, m1;
+
+	memcpy(&m0, TextMaskTable[d0], 8);
+	memcpy(&m1, TextMaskTable[d1], 8);
+
+	__m128i mask = _mm_set_epi64x(m1, m0);
+	__m128i f    = _mm_set_epi64x(fg1 * ones, fg0 * ones);
+	__m128i b    = _mm_set_epi64x(bg1 * ones, bg0 * ones);
+	_mm_storeu_si128((__m128i *)p, _mm_xor_si128(b, _mm_and_si128(_mm_xor_si128(f, b), mask)));
+#else
+	expand_hires_char(p, d0, fg0, bg0);
+	expand_hires_char(p + 8, d1, fg1, bg1);
+#endif
+}
+#endif
 
 MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Char, uint8 *Color)
 #ifndef GLOBAL_VARS
@@ -320,11 +389,16 @@ MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Ch
 	skip_counter = 1;
 
 	// Clear foreground mask
-	memset(fore_mask_buf, 0, DISPLAY_X/8);
+	memset(fore_mask_buf, 0, sizeof(fore_mask_buf));
+
+	// Nothing rendered yet
+	InvalidateLineCache();
 
 	// Preset colors to black
 	disp->InitColors(colors);
+#ifdef TEXT_COLOR_TABLE
 	init_text_color_table(colors);
+#endif
 	ec_color = b0c_color = b1c_color = b2c_color = b3c_color = mm0_color = mm1_color = colors[0];
 	ec_color_long = (ec_color << 24) | (ec_color << 16) | (ec_color << 8) | ec_color;
 	for (i=0; i<8; i++) spr_color[i] = colors[0];
@@ -348,12 +422,17 @@ void MOS6569::ReInitColors(void)
 
 	// Get the new colors.
 	the_display->InitColors(colors);
+#ifdef TEXT_COLOR_TABLE
 	init_text_color_table(colors);
+#endif
 
 	// Build color translation table.
 	for (i = 0; i < 256; i++)
 		xlate_colors[i] = colors[xlate_colors[i]];
 
+	// The chunky buffer is translated below, render everything again
+	InvalidateLineCache();
+
 	// Translate all the old colors variables.
 	ec_color      = colors[ec];
 	ec_color_long = ec_color | (ec_color << 8) | (ec_color << 16) | (ec_color << 24);
@@ -379,6 +458,17 @@ void MOS6569::ReInitColors(void)
    }
 }
 
+
+/*
+ *  Forget all cached line graphics
+ */
+
+void MOS6569::InvalidateLineCache(void)
+{
+	for (unsigned i = 0; i < LINE_CACHE_SIZE; i++)
+		line_cache[i].valid = line_cache[i].border = false;
+}
+
 #ifdef GLOBAL_VARS
 static void make_mc_table(void)
 #else
@@ -730,6 +820,9 @@ uint8 MOS6569::ReadRegister(uint16 adr)
 
 void MOS6569::WriteRegister(uint16 adr, uint8 byte)
 {
+#ifdef FRODO_HYBRID
+	the_c64->NoteVICWrite(adr, byte, raster_y);
+#endif
 	switch (adr)
    {
       case 0x00: case 0x02: case 0x04: case 0x06:
@@ -921,7 +1014,7 @@ inline void MOS6569::vblank(void)
    lp_triggered = false;
 
    if (!(frame_skipped = --skip_counter))
-      skip_counter = ThePrefs.SkipFrames;
+      skip_counter = the_c64->MachinePrefs->SkipFrames;
 
    the_c64->VBlank(!frame_skipped);
 
@@ -939,10 +1032,11 @@ inline void MOS6569::el_std_text(uint8 *p, uint8 *q, uint8 *r)
 #endif
 {
    unsigned i;
-	unsigned int b0cc = b0c;
-	uint32 *lp        = (uint32 *)p;
 	uint8 *cp         = color_line;
 	uint8 *mp         = matrix_line;
+#ifdef TEXT_COLOR_TABLE
+	unsigned int b0cc = b0c;
+	uint32 *lp        = (uint32 *)p;
 
 	// Loop for 40 characters
 	for (i=0; i<40; i++)
@@ -953,6 +1047,18 @@ inline void MOS6569::el_std_text(uint8 *p, uint8 *q, uint8 *r)
       *lp++       = TextColorTable[color][b0cc][data][0].b;
       *lp++       = TextColorTable[color][b0cc][data][1].b;
    }
+#else
+	uint8 b0cc = b0c_color;
+
+	// Loop for 40 characters, two at a time
+	for (i=0; i<40; i+=2, p+=16)
+   {
+      uint8 d0 = r[i]     = q[mp[i] << 3];
+      uint8 d1 = r[i + 1] = q[mp[i + 1] << 3];
+
+      expand_hires_pair(p, d0, d1, colors[cp[i]], colors[cp[i + 1]], b0cc, b0cc);
+   }
+#endif
 }
 
 
@@ -983,10 +1089,15 @@ inline void MOS6569::el_mc_text(uint8 *p, uint8 *q, uint8 *r)
 		} else { // Standard mode in multicolor mode
 			uint8 color = cp[i];
 			r[i] = data;
+#ifdef TEXT_COLOR_TABLE
 			*(uint32 *)wp = TextColorTable[color][b0c][data][0].b;
 			wp += 2;
 			*(uint32 *)wp = TextColorTable[color][b0c][data][1].b;
 			wp += 2;
+#else
+			expand_hires_char((uint8 *)wp, data, colors[color], b0c_color);
+			wp += 4;
+#endif
 		}
 	}
 }
@@ -998,8 +1109,9 @@ static inline void el_std_bitmap(uint8 *p, uint8 *q, uint8 *r)
 inline void MOS6569::el_std_bitmap(uint8 *p, uint8 *q, uint8 *r)
 #endif
 {
-	uint32 *lp = (uint32 *)p;
 	uint8 *mp = matrix_line;
+#ifdef TEXT_COLOR_TABLE
+	uint32 *lp = (uint32 *)p;
 
 	// Loop for 40 characters
 	for (int i=0; i<40; i++, q+=8) {
@@ -1010,6 +1122,16 @@ inline void MOS6569::el_std_bitmap(uint8 *p, uint8 *q, uint8 *r)
 		*lp++ = TextColorTable[color][bcolor][data][0].b;
 		*lp++ = TextColorTable[color][bcolor][data][1].b;
 	}
+#else
+	// Loop for 40 characters, two at a time
+	for (int i=0; i<40; i+=2, q+=16, p+=16) {
+		uint8 d0 = r[i]     = q[0];
+		uint8 d1 = r[i + 1] = q[8];
+
+		expand_hires_pair(p, d0, d1, colors[mp[i] >> 4], colors[mp[i + 1] >> 4],
+				colors[mp[i] & 15], colors[mp[i + 1] & 15]);
+	}
+#endif
 }
 
 
@@ -1060,10 +1182,11 @@ static inline void el_ecm_text(uint8 *p, uint8 *q, uint8 *r)
 inline void MOS6569::el_ecm_text(uint8 *p, uint8 *q, uint8 *r)
 #endif
 {
-	uint32 *lp = (uint32 *)p;
 	uint8 *cp = color_line;
 	uint8 *mp = matrix_line;
 	uint8 *bcp = &b0c;
+#ifdef TEXT_COLOR_TABLE
+	uint32 *lp = (uint32 *)p;
 
 	// Loop for 40 characters
 	for (int i=0; i<40; i++) {
@@ -1075,6 +1198,17 @@ inline void MOS6569::el_ecm_text(uint8 *p, uint8 *q, uint8 *r)
 		*lp++ = TextColorTable[color][bcolor][data][0].b;
 		*lp++ = TextColorTable[color][bcolor][data][1].b;
 	}
+#else
+	// Loop for 40 characters, two at a time
+	for (int i=0; i<40; i+=2, p+=16) {
+		uint8 m0 = r[i]     = mp[i];
+		uint8 m1 = r[i + 1] = mp[i + 1];
+
+		expand_hires_pair(p, q[(m0 & 0x3f) << 3], q[(m1 & 0x3f) << 3],
+				colors[cp[i]], colors[cp[i + 1]],
+				colors[bcp[(m0 >> 6) & 3]], colors[bcp[(m1 >> 6) & 3]]);
+	}
+#endif
 }
 
 
@@ -1086,8 +1220,15 @@ inline void MOS6569::el_std_idle(uint8 *p, uint8 *r)
 {
 	uint8 data = *get_physical(ctrl1 & 0x40 ? 0x39ff : 0x3fff);
 	uint32 *lp = (uint32 *)p;
+#ifdef TEXT_COLOR_TABLE
 	uint32 conv0 = TextColorTable[0][b0c][data][0].b;
 	uint32 conv1 = TextColorTable[0][b0c][data][1].b;
+#else
+	uint32 conv[2], conv0, conv1;
+	expand_hires_char((uint8 *)conv, data, colors[0], b0c_color);
+	conv0 = conv[0];
+	conv1 = conv[1];
+#endif
 
 	for (int i=0; i<40; i++) {
 		*lp++ = conv0;
@@ -1121,211 +1262,132 @@ inline void MOS6569::el_mc_idle(uint8 *p, uint8 *r)
 	}
 }
 
+/*
+ *  Paint 8 sprite pixels, mask bit 7 is the leftmost pixel. p0/p1 are the
+ *  bitplanes of a multicolor sprite, a standard sprite only has p1 set.
+ */
+
+static inline void spr_paint8(uint8 *p, uint8 p0, uint8 p1, uint64 c01, uint64 c10, uint64 c11)
+{
+	uint64 m0, m1, col, pix;
+
+	memcpy(&m0, TextMaskTable[p0], 8);
+	memcpy(&m1, TextMaskTable[p1], 8);
+	memcpy(&pix, p, 8);
+
+	col = c01 ^ ((c01 ^ c10) & m1);		// 01: mm0, 10: sprite color
+	col ^= (col ^ c11) & (m0 & m1);		// 11: mm1
+	pix ^= (pix ^ col) & (m0 | m1);
+	memcpy(p, &pix, 8);
+}
+
 #ifdef GLOBAL_VARS
 static inline void el_sprites(uint8 *chunky_ptr)
 #else
 inline void MOS6569::el_sprites(uint8 *chunky_ptr)
 #endif
 {
-   int i;
-   int snum, sbit;		// Sprite number/bit mask
+   const uint64 ones = 0x0101010101010101ULL;
+   int i, j, k, n;
    int spr_coll=0, gfx_coll=0;
 
-   // Draw each active sprite
-   for (snum=0, sbit=1; snum<8; snum++, sbit<<=1)
-      if ((sprite_on & sbit) && mx[snum] < DISPLAY_X-32) {
-         int spr_mask_pos;	// Sprite bit position in fore_mask_buf
-         uint32 sdata, fore_mask;
-
-         uint8 *p = chunky_ptr + mx[snum] + 8;
-         uint8 *q = spr_coll_buf + mx[snum] + 8;
-
-         uint8 *sdatap = get_physical(matrix_base[0x3f8 + snum] << 6 | mc[snum]);
-         sdata = (*sdatap << 24) | (*(sdatap+1) << 16) | (*(sdatap+2) << 8);
-
-         uint8 color = spr_color[snum];
-
-         spr_mask_pos = mx[snum] + 8 - x_scroll;
-
-         uint8 *fmbp = fore_mask_buf + (spr_mask_pos / 8);
-         int sshift = spr_mask_pos & 7;
-         fore_mask = (((*(fmbp+0) << 24) | (*(fmbp+1) << 16) | (*(fmbp+2) << 8)
-                  | (*(fmbp+3))) << sshift) | (*(fmbp+4) >> (8-sshift));
-
-         if (mxe & sbit) {		// X-expanded
-            if (mx[snum] >= DISPLAY_X-56)
-               continue;
-
-            uint32 sdata_l = 0, sdata_r = 0, fore_mask_r;
-            fore_mask_r = (((*(fmbp+4) << 24) | (*(fmbp+5) << 16) | (*(fmbp+6) << 8)
-                     | (*(fmbp+7))) << sshift) | (*(fmbp+8) >> (8-sshift));
-
-            if (mmc & sbit) {	// Multicolor mode
-               uint32 plane0_l, plane0_r, plane1_l, plane1_r;
-
-               // Expand sprite data
-               sdata_l = MultiExpTable[sdata >> 24 & 0xff] << 16 | MultiExpTable[sdata >> 16 & 0xff];
-               sdata_r = MultiExpTable[sdata >> 8 & 0xff] << 16;
-
-               // Convert sprite chunky pixels to bitplanes
-               plane0_l = (sdata_l & 0x55555555) | (sdata_l & 0x55555555) << 1;
-               plane1_l = (sdata_l & 0xaaaaaaaa) | (sdata_l & 0xaaaaaaaa) >> 1;
-               plane0_r = (sdata_r & 0x55555555) | (sdata_r & 0x55555555) << 1;
-               plane1_r = (sdata_r & 0xaaaaaaaa) | (sdata_r & 0xaaaaaaaa) >> 1;
-
-               // Collision with graphics?
-               if ((fore_mask & (plane0_l | plane1_l)) || (fore_mask_r & (plane0_r | plane1_r))) {
-                  gfx_coll |= sbit;
-                  if (mdp & sbit)	{
-                     plane0_l &= ~fore_mask;	// Mask sprite if in background
-                     plane1_l &= ~fore_mask;
-                     plane0_r &= ~fore_mask_r;
-                     plane1_r &= ~fore_mask_r;
-                  }
-               }
-
-               // Paint sprite
-               for (i=0; i<32; i++, plane0_l<<=1, plane1_l<<=1) {
-                  uint8 col;
-                  if (plane1_l & 0x80000000) {
-                     if (plane0_l & 0x80000000)
-                        col = mm1_color;
-                     else
-                        col = color;
-                  } else {
-                     if (plane0_l & 0x80000000)
-                        col = mm0_color;
-                     else
-                        continue;
-                  }
-                  if (q[i])
-                     spr_coll |= q[i] | sbit;
-                  else {
-                     p[i] = col;
-                     q[i] = sbit;
-                  }
-               }
-               for (; i<48; i++, plane0_r<<=1, plane1_r<<=1) {
-                  uint8 col;
-                  if (plane1_r & 0x80000000) {
-                     if (plane0_r & 0x80000000)
-                        col = mm1_color;
-                     else
-                        col = color;
-                  } else {
-                     if (plane0_r & 0x80000000)
-                        col = mm0_color;
-                     else
-                        continue;
-                  }
-                  if (q[i])
-                     spr_coll |= q[i] | sbit;
-                  else {
-                     p[i] = col;
-                     q[i] = sbit;
-                  }
-               }
-
-            } else {			// Standard mode
-
-               // Expand sprite data
-               sdata_l = ExpTable[sdata >> 24 & 0xff] << 16 | ExpTable[sdata >> 16 & 0xff];
-               sdata_r = ExpTable[sdata >> 8 & 0xff] << 16;
-
-               // Collision with graphics?
-               if ((fore_mask & sdata_l) || (fore_mask_r & sdata_r)) {
-                  gfx_coll |= sbit;
-                  if (mdp & sbit)	{
-                     sdata_l &= ~fore_mask;	// Mask sprite if in background
-                     sdata_r &= ~fore_mask_r;
-                  }
-               }
-
-               // Paint sprite
-               for (i=0; i<32; i++, sdata_l<<=1)
-                  if (sdata_l & 0x80000000) {
-                     if (q[i])	// Collision with sprite?
-                        spr_coll |= q[i] | sbit;
-                     else {		// Draw pixel if no collision
-                        p[i] = color;
-                        q[i] = sbit;
-                     }
-                  }
-               for (; i<48; i++, sdata_r<<=1)
-                  if (sdata_r & 0x80000000) {
-                     if (q[i]) 	// Collision with sprite?
-                        spr_coll |= q[i] | sbit;
-                     else {		// Draw pixel if no collision
-                        p[i] = color;
-                        q[i] = sbit;
-                     }
-                  }
-            }
-
-         } else					// Unexpanded
-
-            if (mmc & sbit) {	// Multicolor mode
-               uint32 plane0, plane1;
-
-               // Convert sprite chunky pixels to bitplanes
-               plane0 = (sdata & 0x55555555) | (sdata & 0x55555555) << 1;
-               plane1 = (sdata & 0xaaaaaaaa) | (sdata & 0xaaaaaaaa) >> 1;
-
-               // Collision with graphics?
-               if (fore_mask & (plane0 | plane1)) {
-                  gfx_coll |= sbit;
-                  if (mdp & sbit) {
-                     plane0 &= ~fore_mask;	// Mask sprite if in background
-                     plane1 &= ~fore_mask;
-                  }
-               }
+   // Occupancy masks of the active sprites, left aligned (bit 63 is the
+   // leftmost pixel), in order of priority
+   int snum[8], pos[8], width[8];
+   uint64 occ[8], plane0[8], plane1[8];
+
+   // Build the sprite masks and check collisions with graphics
+   for (k=0, n=0; k<8; k++) {
+      int sbit = 1 << k;
+      if (!(sprite_on & sbit) || mx[k] >= DISPLAY_X-32)
+         continue;
+      if ((mxe & sbit) && mx[k] >= DISPLAY_X-56)
+         continue;
+
+      uint8 *sdatap = get_physical(matrix_base[0x3f8 + k] << 6 | mc[k]);
+      uint64 sdata, p0, p1, fore_mask;
+
+      if (mxe & sbit) {		// X-expanded
+         const uint16 *exp = (mmc & sbit) ? MultiExpTable : ExpTable;
+         sdata = (uint64)exp[sdatap[0]] << 48 | (uint64)exp[sdatap[1]] << 32 | (uint64)exp[sdatap[2]] << 16;
+         width[n] = 6;
+      } else {
+         sdata = (uint64)sdatap[0] << 56 | (uint64)sdatap[1] << 48 | (uint64)sdatap[2] << 40;
+         width[n] = 3;
+      }
 
-               // Paint sprite
-               for (i=0; i<24; i++, plane0<<=1, plane1<<=1) {
-                  uint8 col;
-                  if (plane1 & 0x80000000) {
-                     if (plane0 & 0x80000000)
-                        col = mm1_color;
-                     else
-                        col = color;
-                  } else {
-                     if (plane0 & 0x80000000)
-                        col = mm0_color;
-                     else
-                        continue;
-                  }
-                  if (q[i])
-                     spr_coll |= q[i] | sbit;
-                  else {
-                     p[i] = col;
-                     q[i] = sbit;
-                  }
-               }
+      if (mmc & sbit) {		// Multicolor mode, convert chunky pixels to bitplanes
+         p0 = (sdata & 0x5555555555555555ULL) | (sdata & 0x5555555555555555ULL) << 1;
+         p1 = (sdata & 0xaaaaaaaaaaaaaaaaULL) | (sdata & 0xaaaaaaaaaaaaaaaaULL) >> 1;
+      } else {
+         p0 = 0;
+         p1 = sdata;
+      }
 
-            } else {			// Standard mode
+      // Foreground mask under the sprite
+      int spr_mask_pos = mx[k] + 8 - x_scroll;	// Sprite bit position in fore_mask_buf
+      uint8 *fmbp = fore_mask_buf + (spr_mask_pos / 8);
+      int sshift = spr_mask_pos & 7;
+      fore_mask = 0;
+      for (i=0; i<8; i++)
+         fore_mask = fore_mask << 8 | fmbp[i];
+      fore_mask = fore_mask << sshift | fmbp[8] >> (8-sshift);
+
+      // Collision with graphics?
+      if (fore_mask & (p0 | p1)) {
+         gfx_coll |= sbit;
+         if (mdp & sbit) {
+            p0 &= ~fore_mask;	// Mask sprite if in background
+            p1 &= ~fore_mask;
+         }
+      }
 
-               // Collision with graphics?
-               if (fore_mask & sdata) {
-                  gfx_coll |= sbit;
-                  if (mdp & sbit)
-                     sdata &= ~fore_mask;	// Mask sprite if in background
-               }
+      snum[n] = k;
+      pos[n] = mx[k];
+      plane0[n] = p0;
+      plane1[n] = p1;
+      occ[n++] = p0 | p1;
+   }
 
-               // Paint sprite
-               for (i=0; i<24; i++, sdata<<=1)
-                  if (sdata & 0x80000000) {
-                     if (q[i]) {		// Collision with sprite?
-                        spr_coll |= q[i] | sbit;
-                     } else {		// Draw pixel if no collision
-                        p[i] = color;
-                        q[i] = sbit;
-                     }
-                  }
+   // Sprite-sprite collisions can only change $d01e while the bit of
+   // an active sprite isn't latched yet, i.e. until $d01e is read the
+   // overlaps of sprites that already collided needn't be checked
+   bool spr_coll_open = the_c64->MachinePrefs->SpriteCollisions
+      && (sprite_on & ~clx_spr);
+
+   // Resolve sprite-sprite priorities and collisions, each sprite
+   // is hidden by the lower numbered sprites it overlaps with
+   for (i=1; i<n; i++) {
+      uint64 covered = 0;
+      for (j=0; j<i; j++) {
+         int d = pos[j] - pos[i];
+         if (d >= 48 || d <= -48)
+            continue;
+         uint64 m = d >= 0 ? occ[j] >> d : occ[j] << -d;
+         if (spr_coll_open && (occ[i] & m))
+            spr_coll |= 1 << snum[i] | 1 << snum[j];
+         covered |= m;
+      }
+      plane0[i] &= ~covered;
+      plane1[i] &= ~covered;
+   }
 
-            }
+   // Paint the visible pixels
+   for (i=0; i<n; i++) {
+      uint8 *p = chunky_ptr + pos[i] + 8;
+      uint64 c01 = mm0_color * ones;
+      uint64 c10 = spr_color[snum[i]] * ones;
+      uint64 c11 = mm1_color * ones;
+
+      for (j=0; j<width[i]; j++, p+=8) {
+         uint8 p0 = plane0[i] >> (56 - 8*j);
+         uint8 p1 = plane1[i] >> (56 - 8*j);
+         if (p0 | p1)
+            spr_paint8(p, p0, p1, c01, c10, c11);
       }
+   }
 
-   if (ThePrefs.SpriteCollisions) {
+   if (the_c64->MachinePrefs->SpriteCollisions) {
 
       // Check sprite-sprite collisions
       if (clx_spr)
@@ -1405,13 +1467,71 @@ inline int MOS6569::el_update_mc(int raster)
    return cycles_used;
 }
 
+
+/*
+ *  Check if the graphics of the current line are the same as when the
+ *  line was last rendered, the cache entry is updated on a miss
+ */
+
+#ifdef GLOBAL_VARS
+static bool el_cache_hit(VICLineCache *lc, uint8 *chunky_ptr)
+#else
+bool MOS6569::el_cache_hit(VICLineCache *lc, uint8 *chunky_ptr)
+#endif
+{
+	uint8 gfx[40];
+	uint8 *q;
+	int i;
+
+	// Fetch the graphics data like the el_*() functions do
+	switch (display_idx) {
+		case 0:		// Standard text
+		case 1:		// Multicolor text
+			q = char_base + rc;
+			for (i=0; i<40; i++)
+				gfx[i] = q[matrix_line[i] << 3];
+			break;
+		case 2:		// Standard bitmap
+		case 3:		// Multicolor bitmap
+			q = bitmap_base + (vc << 3) + rc;
+			for (i=0; i<40; i++, q+=8)
+				gfx[i] = *q;
+			break;
+		default:	// ECM text
+			q = char_base + rc;
+			for (i=0; i<40; i++)
+				gfx[i] = q[(matrix_line[i] & 0x3f) << 3];
+			break;
+	}
+
+	if (lc->valid && lc->chunky == chunky_ptr && lc->mode == display_idx
+			&& lc->x_scroll == x_scroll && lc->border_40_col == border_40_col
+			&& lc->bgc[0] == b0c && lc->bgc[1] == b1c && lc->bgc[2] == b2c && lc->bgc[3] == b3c
+			&& !memcmp(lc->gfx, gfx, 40)
+			&& !memcmp(lc->matrix, matrix_line, 40)
+			&& !memcmp(lc->color, color_line, 40))
+		return true;
+
+	lc->valid         = false;
+	lc->chunky        = chunky_ptr;
+	lc->mode          = display_idx;
+	lc->x_scroll      = x_scroll;
+	lc->border_40_col = border_40_col;
+	lc->bgc[0] = b0c; lc->bgc[1] = b1c; lc->bgc[2] = b2c; lc->bgc[3] = b3c;
+	memcpy(lc->gfx, gfx, 40);
+	memcpy(lc->matrix, matrix_line, 40);
+	memcpy(lc->color, color_line, 40);
+	return false;
+}
+
+
 /*
  *  Emulate one raster line
  */
 
 int MOS6569::EmulateLine(void)
 {
-   int cycles_left = ThePrefs.NormalCycles;	// Cycles left for CPU
+   int cycles_left = the_c64->MachinePrefs->NormalCycles;	// Cycles left for CPU
    bool is_bad_line = false;
 
    // Get raster counter into local variable for faster access and increment
@@ -1437,7 +1557,7 @@ int MOS6569::EmulateLine(void)
    if (frame_skipped) {
       if (raster >= FIRST_DMA_LINE && raster <= LAST_DMA_LINE && ((raster & 7) == y_scroll) && bad_lines_enabled) {
          is_bad_line = true;
-         cycles_left = ThePrefs.BadLineCycles;
+         cycles_left = the_c64->MachinePrefs->BadLineCycles;
       }
       goto VIC_nop;
    }
@@ -1447,6 +1567,8 @@ int MOS6569::EmulateLine(void)
 
       // Our output goes here
       uint8 *chunky_ptr = chunky_line_start;
+      VICLineCache *lc = line_cache + (raster - FIRST_DISP_LINE);
+      bool line_same = false;	// Line looks the same as in the last frame
 
       // Set video counter
       vc = vc_base;
@@ -1456,7 +1578,7 @@ int MOS6569::EmulateLine(void)
 
          // Turn on display
          display_state = is_bad_line = true;
-         cycles_left = ThePrefs.BadLineCycles;
+         cycles_left = the_c64->MachinePrefs->BadLineCycles;
          rc = 0;
 
          // Read and latch 40 bytes from video matrix and color RAM
@@ -1495,7 +1617,15 @@ int MOS6569::EmulateLine(void)
             p++;
          }
 
-         if (display_state) {
+         if (display_state && display_idx < 5 && el_cache_hit(lc, chunky_ptr)) {
+
+            // Graphics unchanged since the last frame, the pixels are
+            // still in the chunky buffer
+            memcpy(r, lc->fore, 40);
+            vc += 40;
+            line_same = !lc->border && lc->ec == ec;
+
+         } else if (display_state) {
             switch (display_idx) {
 
                case 0:	// Standard text
@@ -1595,7 +1725,14 @@ int MOS6569::EmulateLine(void)
             }
             vc += 40;
 
+            // Remember the rendered graphics for the next frame
+            if (display_idx < 5) {
+               memcpy(lc->fore, r, 40);
+               lc->valid = true;
+            }
+
          } else {	// Idle state graphics
+            lc->valid = false;
             switch (display_idx) {
 
                case 0:		// Standard text
@@ -1642,14 +1779,13 @@ int MOS6569::EmulateLine(void)
          }
 
          // Draw sprites
-         if (sprite_on && ThePrefs.SpritesOn) {
-
-            // Clear sprite collision buffer
-            uint32 *lp = (uint32 *)spr_coll_buf - 1;
-            for (int i=0; i<DISPLAY_X/4; i++)
-               *++lp = 0;
+         if (sprite_on && the_c64->MachinePrefs->SpritesOn) {
 
             el_sprites(chunky_ptr);
+
+            // Sprites were drawn over the graphics
+            lc->valid = false;
+            line_same = false;
          }
 
          // Handle left/right border
@@ -1669,16 +1805,27 @@ int MOS6569::EmulateLine(void)
             for (int i=0; i<COL40_XSTOP-COL38_XSTOP; i++)
                *++p = c;
          }
+         lc->border = false;
       }
       else
       {
          // Display border
+         line_same  = lc->border && lc->ec == ec && lc->chunky == chunky_ptr;
+         lc->valid  = false;
+         lc->border = true;
+         lc->chunky = chunky_ptr;
          uint32 *lp = (uint32 *)chunky_ptr - 1;
          uint32 c = ec_color_long;
          for (int i=0; i<DISPLAY_X/4; i++)
             *++lp = c;
       }
 
+      // Tell the display which lines have to be converted again
+      lc->ec = ec;
+      if (!line_same)
+         the_display->line_dirty[raster - FIRST_DISP_LINE] = 1;
+      the_display->ConvertLine(raster - FIRST_DISP_LINE);
+
       // Increment pointer in chunky buffer
       chunky_line_start += xmod;
 
@@ -22,10 +22,8 @@
 #define _VIC_H
 
 
-// Define this if you want global variables instead of member variables
-#if defined(__i386) || defined(mc68000) || defined(__MC68K__)
-#define GLOBAL_VARS
-#endif
+// Define GLOBAL_VARS if you want global variables instead of member
+// variables. Only one VIC (and thus one C64) can exist then.
 
 // Define this if you have a processor that can do unaligned accesses quickly
 #if defined(__i386) || defined(mc68000) || defined(__MC68K__)
@@ -45,6 +43,28 @@ class C64Display;
 class C64;
 struct MOS6569State;
 
+#ifndef FRODO_SC
+// Number of lines in the line graphics cache (displayed lines)
+const unsigned LINE_CACHE_SIZE = 0x110;
+
+// Line graphics cache entry, holds everything the graphics of a
+// display line were rendered from
+struct VICLineCache {
+	uint8 *chunky;				// Line in the chunky bitmap buffer
+	bool valid;					// Flag: Pixels in the buffer are unchanged since rendering
+	uint8 mode;					// Display mode
+	uint8 x_scroll;				// X scroll value
+	uint8 border_40_col;		// 40 column border
+	uint8 bgc[4];				// Background colors b0c..b3c
+	uint8 gfx[40];				// Graphics data
+	uint8 matrix[40];			// Video matrix line
+	uint8 color[40];			// Color line
+	uint8 fore[40];				// Foreground mask
+	uint8 ec;					// Border color the line was drawn with
+	bool border;				// Flag: Line was drawn as border only
+};
+#endif
+
 
 class MOS6569 {
 public:
@@ -60,6 +80,9 @@ public:
 	void ChangedVA(uint16 new_va);	// CIA VA14/15 has changed
 	void TriggerLightpen(void);		// Trigger lightpen interrupt
 	void ReInitColors(void);
+#ifndef FRODO_SC
+	void InvalidateLineCache(void);	// Chunky buffer was changed outside of the VIC
+#endif
 	void GetState(MOS6569State *vd);
 	void SetState(MOS6569State *vd);
 
@@ -121,8 +144,10 @@ private:
 	int skip_counter;			// Counter for frame-skipping
 
 	long pad0;	// Keep buffers long-aligned
+#ifdef FRODO_SC
 	uint8 spr_coll_buf[0x180];	// Buffer for sprite-sprite collisions and priorities
-	uint8 fore_mask_buf[0x180/8];	// Foreground mask for sprite-graphics collisions and priorities
+#endif
+	uint8 fore_mask_buf[0x180/8 + 8];	// Foreground mask for sprite-graphics collisions and priorities
 #ifndef CAN_ACCESS_UNALIGNED
 	uint8 text_chunky_buf[40*8];	// Line graphics buffer
 #endif
@@ -137,15 +162,13 @@ private:
 	uint8 read_byte(uint16 adr);
 	void matrix_access(void);
 	void graphics_access(void);
-	void draw_graphics(void);
+	void draw_graphics(uint8 *p, uint8 *fore_mask_ptr, int first, int n);
 	void draw_sprites(void);
-	void draw_background(void);
+	void draw_background(uint8 *p, uint8 last_char_data);
+	void draw_queued(void);
 
 	int cycle;					// Current cycle in line (1..63)
 
-	uint8 *chunky_ptr;			// Pointer in chunky bitmap buffer (this is where out output goes)
-	uint8 *fore_mask_ptr;		// Pointer in fore_mask_buf
-
 	uint16 matrix_base;			// Video matrix base
 	uint16 char_base;			// Character generator base
 	uint16 bitmap_base;			// Bitmap base
@@ -170,6 +193,13 @@ private:
 
 	int ml_index;				// Index in matrix/color_line[]
 	uint8 gfx_data, char_data, color_data, last_char_data;
+	int draw_cell;				// Number of 8 pixel cells queued in this line
+	int draw_done;				// Number of 8 pixel cells drawn in this line
+	uint8 draw_op[0x180/8];		// Queued cells: what to draw (DRAW_*)
+	uint8 draw_gfx[0x180/8];	// Queued cells: gfx_data, char_data, color_data
+	uint8 draw_char[0x180/8];	// and last_char_data of the cycle
+	uint8 draw_color[0x180/8];
+	uint8 draw_last_char[0x180/8];
 	uint8 spr_data[8][4];		// Sprite data read
 	uint8 spr_draw_data[8][4];	// Sprite data for drawing
 
@@ -186,6 +216,7 @@ private:
 	void el_mc_idle(uint8 *p, uint8 *r);
 	void el_sprites(uint8 *chunky_ptr);
 	int el_update_mc(int raster);
+	bool el_cache_hit(VICLineCache *lc, uint8 *chunky_ptr);
 
 	uint16 mc_color_lookup[4];
 
@@ -195,6 +226,8 @@ private:
 	uint8 *matrix_base;			// Video matrix base
 	uint8 *char_base;			// Character generator base
 	uint8 *bitmap_base;			// Bitmap base
+
+	VICLineCache line_cache[LINE_CACHE_SIZE];	// Graphics of the displayed lines
 #endif
 #endif
 };
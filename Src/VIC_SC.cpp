@@ -44,6 +44,7 @@
 #include "CPUC64.h"
 #include "Display.h"
 #include "Prefs.h"
+#include "TableGen.h"
 
 
 // First and last displayed line
@@ -73,6 +74,13 @@ const int COL38_XSTART = 0x27;
 const int COL38_XSTOP = 0x157;
 #endif
 
+// What to draw for a queued cycle
+enum {
+	DRAW_BG = 1,		// Background
+	DRAW_GFX = 2,		// Graphics (after the background if both are set)
+	DRAW_UD_BORDER = 4	// Upper/lower border is on, graphics show the background
+};
+
 
 // Tables for sprite X expansion
 uint16 ExpTable[256] = {
@@ -145,6 +153,9 @@ uint16 MultiExpTable[256] = {
 	0xFFA0, 0xFFA5, 0xFFAA, 0xFFAF, 0xFFF0, 0xFFF5, 0xFFFA, 0xFFFF
 };
 
+// Used to expand 8 graphics pixels at once
+static const uint8 TextMaskTable[256][8] = { TABLE_256(BIT_MASK_8, 0) };
+
 #ifdef GLOBAL_VARS
 static uint16 mx[8];						// VIC registers
 static uint8 my[8];
@@ -173,9 +184,7 @@ static uint8 spr_color[8];				// Indices for MOB colors
 static uint8 matrix_line[40];			// Buffer for video line, read in Bad Lines
 static uint8 color_line[40];			// Buffer for color line, read in Bad Lines
 
-static uint8 *chunky_ptr;				// Pointer in chunky bitmap buffer
 static uint8 *chunky_line_start;		// Pointer to start of current line in bitmap buffer
-static uint8 *fore_mask_ptr;			// Pointer in fore_mask_buf
 static int xmod;						// Number of bytes per row
 
 static uint16 raster_x;					// Current raster x position
@@ -227,10 +236,19 @@ static uint8 spr_draw;					// 8 flags: Draw sprite in this line
 static uint16 spr_ptr[8];				// Sprite data pointers
 
 static uint8 gfx_data, char_data, color_data, last_char_data;
+static int draw_cell;					// Number of 8 pixel cells queued in this line
+static int draw_done;					// Number of 8 pixel cells drawn in this line
+static uint8 draw_op[DISPLAY_X/8];		// Queued cells: what to draw (DRAW_*)
+static uint8 draw_gfx[DISPLAY_X/8];		// Queued cells: gfx_data, char_data, color_data
+static uint8 draw_char[DISPLAY_X/8];	// and last_char_data of the cycle
+static uint8 draw_color[DISPLAY_X/8];
+static uint8 draw_last_char[DISPLAY_X/8];
 static uint8 spr_data[8][4];			// Sprite data read
 static uint8 spr_draw_data[8][4];		// Sprite data for drawing
 
 static uint32 first_ba_cycle;			// Cycle when BA first went low
+
+static void draw_queued(void);
 #endif
 
 
@@ -260,7 +278,7 @@ MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Ch
 	bitmap_base = 0;
 
 	// Get bitmap info
-	chunky_ptr = chunky_line_start = disp->BitmapBase();
+	chunky_line_start = disp->BitmapBase();
 	xmod = disp->BitmapXMod();
 
 	// Initialize VIC registers
@@ -283,6 +301,7 @@ MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Ch
 	ml_index = 0;
 
 	cycle = 1;
+	draw_cell = draw_done = 0;
 	display_idx = 0;
 	display_state = false;
 	border_on = ud_border_on = vblanking = false;
@@ -518,6 +537,7 @@ void MOS6569::SetState(MOS6569State *vd)
 	border_on = vd->border_on;
 
 	cycle = vd->cycle;
+	draw_cell = draw_done = 0;
 	raster_x = vd->raster_x;
 	ml_index = vd->ml_index;
 	ref_cnt = vd->ref_cnt;
@@ -637,6 +657,14 @@ uint8 MOS6569::ReadRegister(uint16 adr)
 
 void MOS6569::WriteRegister(uint16 adr, uint8 byte)
 {
+#ifdef FRODO_HYBRID
+	the_c64->NoteVICWrite(adr, byte, raster_y);
+#endif
+
+	// Draw the cycles queued so far with the old mode, scroll and colors
+	if (draw_cell != draw_done)
+		draw_queued();
+
 	switch (adr) {
 		case 0x00: case 0x02: case 0x04: case 0x06:
 		case 0x08: case 0x0a: case 0x0c: case 0x0e:
@@ -900,17 +928,13 @@ void MOS6569::graphics_access(void)
  */
 
 #ifdef GLOBAL_VARS
-static void draw_background(void)
+static inline void draw_background(uint8 *p, uint8 last_char_data)
 #else
-void MOS6569::draw_background(void)
+inline void MOS6569::draw_background(uint8 *p, uint8 last_char_data)
 #endif
 {
-	uint8 *p = chunky_ptr;
 	uint8 c;
 
-	if (!draw_this_line)
-		return;
-
 	switch (display_idx) {
 		case 0:		// Standard text
 		case 1:		// Multicolor text
@@ -941,128 +965,170 @@ void MOS6569::draw_background(void)
 
 
 /*
- *  Graphics display (8 pixels)
+ *  Expand one byte of graphics data to 8 chunky pixels
+ */
+
+static inline void expand_hires_char(uint8 *p, uint8 data, uint8 fg, uint8 bg)
+{
+	const uint64 ones = 0x0101010101010101ULL;
+	uint64 fg64 = fg * ones;
+	uint64 bg64 = bg * ones;
+	uint64 mask, pix;
+
+	memcpy(&mask, TextMaskTable[data], 8);
+	pix = bg64 ^ ((fg64 ^ bg64) & mask);
+	memcpy(p, &pix, 8);
+}
+
+static inline void expand_multi_char(uint8 *p, uint8 data, uint8 *c)
+{
+	const uint64 ones = 0x0101010101010101ULL;
+	uint64 hi, lo, pix;
+
+	// Pixel pairs with the upper/lower bit set
+	memcpy(&hi, TextMaskTable[(data & 0xaa) | (data & 0xaa) >> 1], 8);
+	memcpy(&lo, TextMaskTable[(data & 0x55) | (data & 0x55) << 1], 8);
+	pix = (c[0] * ones & ~hi & ~lo) | (c[1] * ones & ~hi & lo)
+	    | (c[2] * ones & hi & ~lo) | (c[3] * ones & hi & lo);
+	memcpy(p, &pix, 8);
+}
+
+
+/*
+ *  Graphics display (8 pixels each) of n queued cycles
  */
 
-#ifdef __i386
-inline
-#endif
 #ifdef GLOBAL_VARS
-static void draw_graphics(void)
+static inline void draw_graphics(uint8 *p, uint8 *fore_mask_ptr, int first, int n)
 #else
-void MOS6569::draw_graphics(void)
+inline void MOS6569::draw_graphics(uint8 *p, uint8 *fore_mask_ptr, int first, int n)
 #endif
 {
-	uint8 *p = chunky_ptr + x_scroll;
-	uint8 c[4], data;
-
-	if (!draw_this_line)
-		return;
-	if (ud_border_on) {
-		draw_background();
-		return;
-	}
+	uint8 *gfx = draw_gfx + first, *chr = draw_char + first, *col = draw_color + first;
+	uint8 c[4], data, multi;
+	int i;
 
-	switch (display_idx) {
+	p += x_scroll;
 
-		case 0:		// Standard text
-			c[0] = b0c_color;
-			c[1] = colors[color_data];
-			goto draw_std;
+	for (i=0; i<n; i++, p+=8, fore_mask_ptr++) {
+		data = gfx[i];
 
-		case 1:		// Multicolor text
-			if (color_data & 8) {
-				c[0] = b0c_color;
-				c[1] = b1c_color;
-				c[2] = b2c_color;
-				c[3] = colors[color_data & 7];
-				goto draw_multi;
-			} else {
-				c[0] = b0c_color;
-				c[1] = colors[color_data];
-				goto draw_std;
-			}
+		switch (display_idx) {
 
-		case 2:		// Standard bitmap
-			c[0] = colors[char_data];
-			c[1] = colors[char_data >> 4];
-			goto draw_std;
+			case 0:		// Standard text
+				expand_hires_char(p, data, colors[col[i]], b0c_color);
+				goto std_mask;
 
-		case 3:		// Multicolor bitmap
-			c[0]= b0c_color;
-			c[1] = colors[char_data >> 4];
-			c[2] = colors[char_data];
-			c[3] = colors[color_data];
-			goto draw_multi;
+			case 1:		// Multicolor text
+				if (col[i] & 8) {
+					c[0] = b0c_color;
+					c[1] = b1c_color;
+					c[2] = b2c_color;
+					c[3] = colors[col[i] & 7];
+					expand_multi_char(p, data, c);
+					goto multi_mask;
+				} else {
+					expand_hires_char(p, data, colors[col[i]], b0c_color);
+					goto std_mask;
+				}
 
-		case 4:		// ECM text
-			if (char_data & 0x80)
-				if (char_data & 0x40)
-					c[0] = b3c_color;
-				else
-					c[0] = b2c_color;
-			else
-				if (char_data & 0x40)
-					c[0] = b1c_color;
+			case 2:		// Standard bitmap
+				expand_hires_char(p, data, colors[chr[i] >> 4], colors[chr[i]]);
+				goto std_mask;
+
+			case 3:		// Multicolor bitmap
+				c[0] = b0c_color;
+				c[1] = colors[chr[i] >> 4];
+				c[2] = colors[chr[i]];
+				c[3] = colors[col[i]];
+				expand_multi_char(p, data, c);
+				goto multi_mask;
+
+			case 4:		// ECM text
+				if (chr[i] & 0x80)
+					if (chr[i] & 0x40)
+						c[0] = b3c_color;
+					else
+						c[0] = b2c_color;
 				else
-					c[0] = b0c_color;
-			c[1] = colors[color_data];
-			goto draw_std;
-
-		case 5:		// Invalid multicolor text
-			memset8(p, colors[0]);
-			if (color_data & 8) {
-				fore_mask_ptr[0] |= ((gfx_data & 0xaa) | (gfx_data & 0xaa) >> 1) >> x_scroll;
-				fore_mask_ptr[1] |= ((gfx_data & 0xaa) | (gfx_data & 0xaa) >> 1) << (8-x_scroll);
-			} else {
-				fore_mask_ptr[0] |= gfx_data >> x_scroll;
-				fore_mask_ptr[1] |= gfx_data << (7-x_scroll);
-			}
-			return;
-
-		case 6:		// Invalid standard bitmap
-			memset8(p, colors[0]);
-			fore_mask_ptr[0] |= gfx_data >> x_scroll;
-			fore_mask_ptr[1] |= gfx_data << (7-x_scroll);
-			return;
-
-		case 7:		// Invalid multicolor bitmap
-			memset8(p, colors[0]);
-			fore_mask_ptr[0] |= ((gfx_data & 0xaa) | (gfx_data & 0xaa) >> 1) >> x_scroll;
-			fore_mask_ptr[1] |= ((gfx_data & 0xaa) | (gfx_data & 0xaa) >> 1) << (8-x_scroll);
-			return;
-
-		default:	// Can't happen
-			return;
+					if (chr[i] & 0x40)
+						c[0] = b1c_color;
+					else
+						c[0] = b0c_color;
+				expand_hires_char(p, data, colors[col[i]], c[0]);
+				goto std_mask;
+
+			case 5:		// Invalid multicolor text
+				memset8(p, colors[0]);
+				if (col[i] & 8)
+					goto multi_mask;
+				goto std_mask;
+
+			case 6:		// Invalid standard bitmap
+				memset8(p, colors[0]);
+				goto std_mask;
+
+			case 7:		// Invalid multicolor bitmap
+				memset8(p, colors[0]);
+				goto multi_mask;
+
+			default:	// Can't happen
+				continue;
+		}
+
+std_mask:
+		fore_mask_ptr[0] |= data >> x_scroll;
+		fore_mask_ptr[1] |= data << (7-x_scroll);
+		continue;
+
+multi_mask:
+		multi = (data & 0xaa) | (data & 0xaa) >> 1;
+		fore_mask_ptr[0] |= multi >> x_scroll;
+		fore_mask_ptr[1] |= multi << (8-x_scroll);
 	}
+}
 
-draw_std:
-
-	fore_mask_ptr[0] |= gfx_data >> x_scroll;
-	fore_mask_ptr[1] |= gfx_data << (7-x_scroll);
-
-	data = gfx_data;
-	p[7] = c[data & 1]; data >>= 1;
-	p[6] = c[data & 1]; data >>= 1;
-	p[5] = c[data & 1]; data >>= 1;
-	p[4] = c[data & 1]; data >>= 1;
-	p[3] = c[data & 1]; data >>= 1;
-	p[2] = c[data & 1]; data >>= 1;
-	p[1] = c[data & 1]; data >>= 1;
-	p[0] = c[data];
-	return;
-
-draw_multi:
-
-	fore_mask_ptr[0] |= ((gfx_data & 0xaa) | (gfx_data & 0xaa) >> 1) >> x_scroll;
-	fore_mask_ptr[1] |= ((gfx_data & 0xaa) | (gfx_data & 0xaa) >> 1) << (8-x_scroll);
-
-	data = gfx_data;
-	p[7] = p[6] = c[data & 3]; data >>= 2;
-	p[5] = p[4] = c[data & 3]; data >>= 2;
-	p[3] = p[2] = c[data & 3]; data >>= 2;
-	p[1] = p[0] = c[data];
-	return;
+
+/*
+ *  Draw the cycles queued since the last call. The graphics of a cycle
+ *  only depend on the data fetched in that cycle and on registers, so
+ *  EmulateCycle() just queues them and they are drawn in one go at the
+ *  end of the line, or before a register write changes the mode, scroll
+ *  or colors
+ */
+
+#ifdef GLOBAL_VARS
+static void draw_queued(void)
+#else
+void MOS6569::draw_queued(void)
+#endif
+{
+	int i = draw_done, n;
+	uint8 *p = chunky_line_start + i*8;
+	uint8 *q = fore_mask_buf + i;
+
+	while (i < draw_cell) {
+		uint8 op = draw_op[i];
+
+		// Runs of graphics without background are drawn in one call
+		if (op == DRAW_GFX) {
+			for (n=1; i+n<draw_cell && draw_op[i+n] == DRAW_GFX; n++) ;
+			draw_graphics(p, q, i, n);
+			i += n; p += n*8; q += n;
+			continue;
+		}
+
+		if (op & DRAW_BG)
+			draw_background(p, draw_last_char[i]);
+		if (op & DRAW_GFX) {
+			if (op & DRAW_UD_BORDER)
+				draw_background(p, draw_last_char[i]);
+			else
+				draw_graphics(p, q, i, 1);
+		}
+		i++; p += 8; q++;
+	}
+	draw_done = draw_cell;
 }
 
 
@@ -1280,7 +1346,7 @@ inline void MOS6569::draw_sprites(void)
 		}
 	}
 
-	if (ThePrefs.SpriteCollisions) {
+	if (the_c64->MachinePrefs->SpriteCollisions) {
 
 		// Check sprite-sprite collisions
 		if (clx_spr)
@@ -1371,13 +1437,22 @@ inline void MOS6569::draw_sprites(void)
 	} else if (bytenum == 1) \
 		IdleAccess;
 
-// Sample border color and increment chunky_ptr and fore_mask_ptr
+// Queue drawing of the 8 pixels of this cycle (DRAW_BG and/or DRAW_GFX)
+#define QueueDraw(ops) \
+	if (draw_this_line) { \
+		draw_op[draw_cell] = (ops) | (ud_border_on ? DRAW_UD_BORDER : 0); \
+		draw_gfx[draw_cell] = gfx_data; \
+		draw_char[draw_cell] = char_data; \
+		draw_color[draw_cell] = color_data; \
+		draw_last_char[draw_cell] = last_char_data; \
+	}
+
+// Sample border color and go to the next 8 pixels
 #define SampleBorder \
 	if (draw_this_line) { \
 		if (border_on) \
 			border_color_sample[cycle-13] = ec_color; \
-		chunky_ptr += 8; \
-		fore_mask_ptr++; \
+		draw_cell++; \
 	}
 
 
@@ -1436,7 +1511,7 @@ bool MOS6569::EmulateCycle(void)
 				lp_triggered = vblanking = false;
 
 				if (!(frame_skipped = --skip_counter))
-					skip_counter = ThePrefs.SkipFrames;
+					skip_counter = the_c64->MachinePrefs->SkipFrames;
 
 				the_c64->VBlank(!frame_skipped);
 
@@ -1453,11 +1528,10 @@ bool MOS6569::EmulateCycle(void)
 			}
 
 			// Our output goes here
-			chunky_ptr = chunky_line_start;
+			draw_cell = draw_done = 0;
 
 			// Clear foreground mask
 			memset(fore_mask_buf, 0, DISPLAY_X/8);
-			fore_mask_ptr = fore_mask_buf;
 
 			SprDataAccess(3,1);
 			SprDataAccess(3,2);
@@ -1549,7 +1623,7 @@ bool MOS6569::EmulateCycle(void)
 
 		// Refresh, turn on matrix access if Bad Line, reset raster_x, graphics display starts here
 		case 13:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 			RefreshAccess;
 			FetchIfBadLine;
@@ -1558,7 +1632,7 @@ bool MOS6569::EmulateCycle(void)
 
 		// Refresh, VCBASE->VCCOUNT, turn on matrix access and reset RC if Bad Line
 		case 14:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 			RefreshAccess;
 			RCIfBadLine;
@@ -1567,7 +1641,7 @@ bool MOS6569::EmulateCycle(void)
 
 		// Refresh and matrix access, increment mc_base by 2 if y expansion flipflop is set
 		case 15:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 			RefreshAccess;
 			FetchIfBadLine;
@@ -1583,7 +1657,7 @@ bool MOS6569::EmulateCycle(void)
 		// Graphics and matrix access, increment mc_base by 1 if y expansion flipflop is set
 		// and check if sprite DMA can be turned off
 		case 16:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 			graphics_access();
 			FetchIfBadLine;
@@ -1620,8 +1694,7 @@ bool MOS6569::EmulateCycle(void)
 			// Second sample of border state
 			border_on_sample[1] = border_on;
 
-			draw_background();
-			draw_graphics();
+			QueueDraw(DRAW_BG | DRAW_GFX);
 			SampleBorder;
 			graphics_access();
 			FetchIfBadLine;
@@ -1658,7 +1731,7 @@ bool MOS6569::EmulateCycle(void)
 		case 37: case 38: case 39: case 40: case 41: case 42:
 		case 43: case 44: case 45: case 46: case 47: case 48:
 		case 49: case 50: case 51: case 52: case 53: case 54:	// Gnagna...
-			draw_graphics();
+			QueueDraw(DRAW_GFX);
 			SampleBorder;
 			graphics_access();
 			FetchIfBadLine;
@@ -1669,7 +1742,7 @@ bool MOS6569::EmulateCycle(void)
 		// Last graphics access, turn off matrix access, turn on sprite DMA if Y coordinate is
 		// right and sprite is enabled, handle sprite y expansion, set BA for sprite 0
 		case 55:
-			draw_graphics();
+			QueueDraw(DRAW_GFX);
 			SampleBorder;
 			graphics_access();
 			DisplayIfBadLine;
@@ -1696,7 +1769,7 @@ bool MOS6569::EmulateCycle(void)
 			// Fourth sample of border state
 			border_on_sample[3] = border_on;
 
-			draw_graphics();
+			QueueDraw(DRAW_GFX);
 			SampleBorder;
 			IdleAccess;
 			DisplayIfBadLine;
@@ -1724,7 +1797,7 @@ bool MOS6569::EmulateCycle(void)
 				if ((spr_disp_on & mask) && !(spr_dma_on & mask))
 					spr_disp_on &= ~mask;
 
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 			IdleAccess;
 			DisplayIfBadLine;
@@ -1735,7 +1808,7 @@ bool MOS6569::EmulateCycle(void)
 		// Fetch sprite pointer 0, mc_base->mc, turn on sprite display if necessary,
 		// turn off display if RC=7, read data of sprite 0
 		case 58:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 
 			mask = 1;
@@ -1759,7 +1832,7 @@ bool MOS6569::EmulateCycle(void)
 
 		// Set BA for sprite 2, read data of sprite 0
 		case 59:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 			SprDataAccess(0, 1);
 			SprDataAccess(0, 2);
@@ -1770,13 +1843,16 @@ bool MOS6569::EmulateCycle(void)
 
 		// Fetch sprite pointer 1, reset BA if sprite 1 and 2 off, graphics display ends here
 		case 60:
-			draw_background();
+			QueueDraw(DRAW_BG);
 			SampleBorder;
 
 			if (draw_this_line) {
 
+				// Draw graphics
+				draw_queued();
+
 				// Draw sprites
-				if (spr_draw && ThePrefs.SpritesOn)
+				if (spr_draw && the_c64->MachinePrefs->SpritesOn)
 					draw_sprites();
 
 				// Draw border
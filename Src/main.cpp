@@ -31,9 +31,6 @@
 #include "Version.h"
 
 #include "core-log.h"
-#ifndef NO_LIBCO
-#include "libco.h"
-#endif
 
 #include "sysdeps.h"
 
@@ -52,10 +49,6 @@ int rfclose(RFILE* stream);
 int64_t rfread(void* buffer,
    size_t elem_size, size_t elem_count, RFILE* stream);
 }
-#ifndef NO_LIBCO
-extern cothread_t mainThread;
-extern cothread_t emuThread;
-#endif
 
 /* Global variables */
 C64 *TheC64 = NULL;		/* Global C64 object */
@@ -131,19 +124,16 @@ int skel_main(int argc, char **argv)
 	the_app = new Frodo();
 	the_app->ArgvReceived(argc, argv);
 	the_app->ReadyToRun();
-#ifndef NO_LIBCO
-	delete the_app;
-#endif
 	return 0;
 }
 
-#ifdef NO_LIBCO
 void quit_frodo_emu(void)
 {
 	delete TheC64;
 	delete the_app;
+	TheC64  = NULL;
+	the_app = NULL;
 }
-#endif
 
 /*
  *  Constructor: Initialize member variables
@@ -187,19 +177,15 @@ void Frodo::ReadyToRun(void)
 	}
 
 	// Create and start C64
-	TheC64 = new C64;
+	TheC64 = new C64(&ThePrefs);
 
 	load_rom_files();
 
-#ifndef NO_LIBCO
-	co_switch(mainThread); //return mainthread before enter C64thread
-#endif
+	// Look for a cached power-up state matching these ROMs
+	TheC64->InitPowerUpSnapshot();
 
+	// Frames are driven by retro_run() through C64::RunFrame()
 	TheC64->Run();
-
-#ifndef NO_LIBCO
-	delete TheC64;
-#endif
 }
 
 /* Determine whether path name refers to a directory */
@@ -38,13 +38,18 @@ extern int retro_quit;  // Declaration only - defined in C64.cpp
 
 //VIDEO
 #ifdef  RENDER16B
-uint16_t Retro_Screen[1024*1024];
+uint16_t Retro_Screen[WINDOW_WIDTH*WINDOW_HEIGHT];
 #else
-unsigned int Retro_Screen[1024*1024];
+unsigned int Retro_Screen[WINDOW_WIDTH*WINDOW_HEIGHT];
 #endif 
+#ifndef RENDER16B
+uint16_t Retro_Screen16[WINDOW_WIDTH*WINDOW_HEIGHT];
+#endif
+void *Retro_Output       = Retro_Screen;
+int Retro_OutputPitch    = WINDOW_WIDTH;
+bool Retro_Output565     = (PIXEL_BYTES == 1);
 
 //SOUND
-short signed int SNDBUF[1024*2];
 #if !defined(SF2000)
 int snd_sampler = 44100 / 50;
 #else
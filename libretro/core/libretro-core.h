@@ -11,27 +11,40 @@
 #define UINT16 uint16_t
 #define UINT32 uint32_t
 
+#define WINDOW_WIDTH 384//400
+#define WINDOW_HEIGHT 288//300
+
 //#define RENDER16B
 #ifdef  RENDER16B
-	extern uint16_t Retro_Screen[1024*1024];
+	extern uint16_t Retro_Screen[WINDOW_WIDTH*WINDOW_HEIGHT];
 	#define PIXEL_BYTES 1
 	#define PIXEL_TYPE UINT16
 	#define PITCH 2	
 #else
-	extern unsigned int Retro_Screen[1024*1024];
+	extern unsigned int Retro_Screen[WINDOW_WIDTH*WINDOW_HEIGHT];
 	#define PIXEL_BYTES 2
 	#define PIXEL_TYPE UINT32
 	#define PITCH 4	
 #endif 
 
-#define WINDOW_WIDTH 384//400
-#define WINDOW_HEIGHT 288//300
+// Where the current frame is rendered: the frontend's framebuffer when
+// it provides one, Retro_Screen otherwise. Pitch is in pixels, pixels
+// are RGB565 when Retro_Output565 is set and XRGB8888 otherwise.
+extern void *Retro_Output;
+extern int Retro_OutputPitch;
+extern bool Retro_Output565;
+
+// RGB565 output negotiated with the frontend (frodo_pixel_format)
+extern bool frodo_rgb565;
+#ifndef RENDER16B
+extern uint16_t Retro_Screen16[WINDOW_WIDTH*WINDOW_HEIGHT];
+#endif
 
 #ifndef NO_LIBCO
 #include "libco.h"
 
 extern cothread_t mainThread;
-extern cothread_t emuThread;
+extern cothread_t guiThread;
 #endif
 
 extern char Key_Sate[512];
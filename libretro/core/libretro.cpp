@@ -6,21 +6,27 @@
 #include "libretro_core_options.h"
 #include "Version.h"
 
-#ifdef NO_LIBCO
 #include "main.h"
 #include "C64.h"
 #include "Display.h"
 #include "Prefs.h"
+
+#ifndef RENDER16B
+#define CORE_PIXEL_FORMAT RETRO_PIXEL_FORMAT_XRGB8888
 #else
+#define CORE_PIXEL_FORMAT RETRO_PIXEL_FORMAT_RGB565
+#endif
+
+#ifndef NO_LIBCO
 cothread_t mainThread;
-cothread_t emuThread;
+cothread_t guiThread;
 #endif
 
 int CROP_WIDTH;
 int CROP_HEIGHT;
 int VIRTUAL_WIDTH;
-int retrow=1024; 
-int retroh=1024;
+int retrow=WINDOW_WIDTH; 
+int retroh=WINDOW_HEIGHT;
 
 // Frameskip variables
 int frameskip_type = 0;     // 0 = fixed, 1 = auto
@@ -42,8 +48,15 @@ int overscan_led_bar_h = 11;
 // Frodo_1541emul variable
 bool frodo_1541emul = true;
 
-// Shutdown flag
-static bool shutdown_requested = false;
+// RGB565 output, negotiated in retro_load_game
+#ifdef RENDER16B
+bool frodo_rgb565 = true;
+#else
+bool frodo_rgb565 = false;
+#endif
+
+// Frontend accepts NULL frames to repeat the last one
+static bool can_dupe = false;
 
 // Simple 8x8 font bitmap for splash screen text
 static const unsigned char font_8x8[][8] = {
@@ -119,8 +132,7 @@ static void draw_char(int x, int y, char c, PIXEL_TYPE color) {
          if (byte & (0x80 >> col)) {
             int px = x + col;
             int py = y + row;
-            if (px >= 0 && px < retrow && py >= 0 && py < retroh && 
-                px < 1024 && py < 1024 && (py * retrow + px) < (1024 * 1024)) {
+            if (px >= 0 && px < retrow && py >= 0 && py < retroh) {
                Retro_Screen[py * retrow + px] = color;
             }
          }
@@ -156,22 +168,8 @@ static void draw_splash_screen(void)
 #endif
 
    // Fill entire screen buffer with pink background
-   // Ensure we don't exceed buffer bounds (1024x1024)
-   // Only fill if screen dimensions are safe
-   if (retrow <= 1024 && retroh <= 1024) {
-      for (int y = 0; y < retroh; y++) {
-         for (int x = 0; x < retrow; x++) {
-            int index = y * retrow + x;
-            if (index >= 0 && index < (1024 * 1024)) {
-               Retro_Screen[index] = bg_color;
-            }
-         }
-      }
-   } else {
-      // Fallback: fill first 1024x1024 if dimensions are too large
-      for (int i = 0; i < (1024 * 1024); i++) {
-         Retro_Screen[i] = bg_color;
-      }
+   for (int i = 0; i < retrow * retroh; i++) {
+      Retro_Screen[i] = bg_color;
    }
 
    // Calculate center position for text
@@ -199,13 +197,11 @@ static void draw_splash_screen(void)
    draw_string(center_x - version_width / 2, retroh - 30, version, text_color);
 }
 
-#ifdef NO_LIBCO
 extern C64 *TheC64;
 extern void quit_frodo_emu(void);
-#endif
+extern void pause_select(void);
 
-extern int SHIFTON,pauseg,SND ,snd_sampler;
-extern short signed int SNDBUF[1024*2];
+extern int SHIFTON,pauseg,SND ,snd_sampler,SHOWKEY;
 extern char RPATH[512];
 
 #include "cmdline.c"
@@ -386,25 +382,122 @@ static void update_variables(void)
                 var.value, overscan_crop_left, overscan_crop_right, 
                 overscan_crop_top, overscan_crop_bottom);
    }
-}
 
-static void retro_wrap_emulator(void)
-{
-   pre_main(RPATH);
-#ifndef NO_LIBCO
-   pauseg=-1;
+   // Handle SID emulation option, the SID switches at the next frame
+   var.key   = "frodo_sid";
+   var.value = NULL;
 
-   environ_cb(RETRO_ENVIRONMENT_SHUTDOWN, 0); 
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "fast") == 0)
+         ThePrefs.SIDType = SIDTYPE_FAST;
+      else if (strcmp(var.value, "accurate") == 0)
+         ThePrefs.SIDType = SIDTYPE_ACCURATE;
+      else
+         ThePrefs.SIDType = SIDTYPE_DIGITAL;
 
-   // Were done here
-   co_switch(mainThread);
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "SID emulation set to: %s\n", var.value);
+   }
 
-   // Dead emulator, but libco says not to return
-   // Check for shutdown to avoid infinite loop
-   while(!shutdown_requested)
-      co_switch(mainThread);
+   // Handle extra SID options, mapped in at the next frame
+   var.key   = "frodo_sid2";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      ThePrefs.SID2Address = strcmp(var.value, "none") == 0 ? 0 : strtoul(var.value, NULL, 16);
+
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Second SID: %s\n", var.value);
+   }
+
+   var.key   = "frodo_sid3";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      ThePrefs.SID3Address = strcmp(var.value, "none") == 0 ? 0 : strtoul(var.value, NULL, 16);
+
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Third SID: %s\n", var.value);
+   }
+
+#ifdef HAVE_THREADS
+   // Handle SID worker thread option, started/stopped at the next line
+   var.key   = "frodo_sid_thread";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      ThePrefs.SIDThread = (strcmp(var.value, "true") == 0);
+
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "SID worker thread: %s\n", var.value);
+   }
+#endif
+
+#if !defined(SF2000)
+   // Handle sample rate option, the SID switches at the next frame
+   var.key   = "frodo_sample_rate";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int rate = strtoul(var.value, NULL, 0);
+      if (rate != ThePrefs.SampleRate)
+      {
+         ThePrefs.SampleRate = rate;
+         snd_sampler         = rate / 50;
+
+         // Already running, tell the frontend
+         if (TheC64)
+         {
+            struct retro_system_av_info av_info;
+            retro_get_system_av_info(&av_info);
+            environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &av_info);
+         }
+      }
+
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Sample rate set to: %s\n", var.value);
+   }
+#endif
+
+#ifdef FRODO_HYBRID
+   // Handle engine option, applied by the C64 at the next frame
+   var.key   = "frodo_engine";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "line") == 0)
+         HybridEngine = ENGINE_LINE;
+      else if (strcmp(var.value, "sc") == 0)
+         HybridEngine = ENGINE_SC;
+      else
+         HybridEngine = ENGINE_AUTO;
+
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Engine set to: %s\n", var.value);
+   }
 #endif
+
+   Display_UpdateScaler();
+}
+
+#ifndef NO_LIBCO
+/* The option dialogs are modal loops: they run on their own coroutine
+ * and hand control back to retro_run() from gui_poll_events(). */
+static void retro_wrap_gui(void)
+{
+   for (;;)
+   {
+      pause_select();
+      co_switch(mainThread);
+   }
 }
+#endif
 
 void Emu_init(void)
 {
@@ -413,35 +506,18 @@ void Emu_init(void)
    memset(Key_Sate,0,512);
    memset(Key_Sate2,0,512);
 
-#ifndef NO_LIBCO
-   if(!emuThread && !mainThread)
-   {
-      mainThread = co_active();
-      emuThread = co_create(65536*sizeof(void*), retro_wrap_emulator);
-   }
-#else
-   retro_wrap_emulator();
-#endif
-
+   pre_main(RPATH);
 }
 
 void Emu_uninit(void)
 {
-#ifdef NO_LIBCO
    quit_frodo_emu();
-#else
-   shutdown_requested = true;
-#endif
    texture_uninit();
 }
 
 void retro_shutdown_core(void)
 {
-#ifdef NO_LIBCO
-	quit_frodo_emu();
-#else
-   shutdown_requested = true;
-#endif
+   quit_frodo_emu();
    texture_uninit();
    environ_cb(RETRO_ENVIRONMENT_SHUTDOWN, NULL);
 }
@@ -454,11 +530,7 @@ void retro_init(void)
    const char *save_dir        = NULL;
    const char *content_dir     = NULL;
    const char *system_dir      = NULL;
-#ifndef RENDER16B
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
-#else
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
-#endif
+   enum retro_pixel_format fmt = CORE_PIXEL_FORMAT;
 
    // if defined, use the system directory			
    if (environ_cb(RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY, &system_dir) && system_dir)
@@ -499,9 +571,6 @@ void retro_init(void)
 		{ 0 },
 	};
 	environ_cb(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, &inputDescriptors);
-#ifndef NO_LIBCO
-   Emu_init();
-#endif
    texture_init();
 
 }
@@ -511,13 +580,12 @@ void retro_deinit(void)
    Emu_uninit(); 
 
 #ifndef NO_LIBCO
-   if(emuThread)
+   if(guiThread)
    {	 
-      co_delete(emuThread);
-      emuThread = 0;
+      co_delete(guiThread);
+      guiThread = 0;
    }
 #endif
-   shutdown_requested = false; // Reset for next time
 }
 
 unsigned retro_api_version(void)
@@ -547,12 +615,8 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
   struct retro_game_geometry geom = {
 				     (unsigned int) retrow,
 				     (unsigned int) retroh,
-				     1024, 1024,4.0 / 3.0 };
-#if !defined(SF2000)
-   struct retro_system_timing timing = { 50.0, 44100.0 };
-#else
-   struct retro_system_timing timing = { 50.0, 22050.0 };  // SF2000: PAL 50Hz, 22050Hz audio
-#endif
+				     WINDOW_WIDTH, WINDOW_HEIGHT,4.0 / 3.0 };
+   struct retro_system_timing timing = { 50.0, (double)ThePrefs.SampleRate };
 
    info->geometry = geom;
    info->timing   = timing;
@@ -573,6 +637,28 @@ void retro_set_video_refresh(retro_video_refresh_t cb)
    video_cb = cb;
 }
 
+/* Hand the current frame to the frontend. Frames drawn in 32-bit
+ * (GUI, splash, virtual keyboard) are converted when RGB565 was
+ * negotiated. */
+static void present_frame(void)
+{
+#ifndef RENDER16B
+   if (frodo_rgb565 && !Retro_Output565)
+   {
+      int i;
+      for (i = 0; i < retrow * retroh; i++)
+      {
+         unsigned int c    = Retro_Screen[i];
+         Retro_Screen16[i] = ((c >> 8) & 0xf800) | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f);
+      }
+      video_cb(Retro_Screen16,retrow,retroh,retrow*sizeof(uint16_t));
+      return;
+   }
+#endif
+   video_cb(Retro_Output,retrow,retroh,
+         Retro_OutputPitch*(Retro_Output565 ? sizeof(uint16_t) : sizeof(uint32_t)));
+}
+
 #ifdef NO_LIBCO
 /* TODO/FIXME - nolibco Gui endless loop -> no retro_run() call */
 void retro_run_gui(void)
@@ -582,10 +668,92 @@ void retro_run_gui(void)
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
       update_variables();
 
-   video_cb(Retro_Screen,retrow,retroh,retrow<<PIXEL_BYTES);
+   present_frame();
+   Display_InvalidateOutput();
 }
 #endif
 
+/* Render the next frame into the frontend's framebuffer if it offers one
+ * in our pixel format, otherwise into Retro_Screen, or Retro_Screen16
+ * for emulated frames in RGB565 */
+static void select_output_buffer(bool emulated, bool direct)
+{
+   struct retro_framebuffer fb;
+   size_t bpp;
+
+   Retro_Output      = Retro_Screen;
+   Retro_OutputPitch = retrow;
+   Retro_Output565   = (PIXEL_BYTES == 1);
+
+#ifndef RENDER16B
+   // The virtual keyboard, the GUI and the splash are drawn in 32-bit
+   // only, convert afterwards. Mostly static emulated frames go to
+   // Retro_Screen16, which keeps the lines that didn't change
+   if (frodo_rgb565 && (SHOWKEY == 1 || !emulated))
+      direct = false;
+   else if (frodo_rgb565)
+   {
+      Retro_Output    = Retro_Screen16;
+      Retro_Output565 = true;
+   }
+#endif
+   bpp = Retro_Output565 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+   if (direct)
+   {
+      memset(&fb, 0, sizeof(fb));
+      fb.width        = retrow;
+      fb.height       = retroh;
+      fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+      if (environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb)
+            && fb.data
+            && fb.format == (Retro_Output565 ? RETRO_PIXEL_FORMAT_RGB565
+               : RETRO_PIXEL_FORMAT_XRGB8888)
+            && fb.width  >= (unsigned)retrow
+            && fb.height >= (unsigned)retroh
+            && (fb.pitch % bpp) == 0)
+      {
+         Retro_Output      = fb.data;
+         Retro_OutputPitch = fb.pitch / bpp;
+      }
+   }
+
+   // graph.cpp draws the virtual keyboard with this stride
+   VIRTUAL_WIDTH = Retro_OutputPitch;
+}
+
+/* Negotiate the pixel format picked in the core options, falls back
+ * to the compiled-in format when the frontend refuses RGB565 */
+static void set_pixel_format(void)
+{
+#ifndef RENDER16B
+   struct retro_variable var;
+   enum retro_pixel_format fmt;
+
+   var.key   = "frodo_pixel_format";
+   var.value = NULL;
+
+   frodo_rgb565 = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value
+         && strcmp(var.value, "rgb565") == 0)
+   {
+      fmt = RETRO_PIXEL_FORMAT_RGB565;
+      if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+         frodo_rgb565 = true;
+      else
+      {
+         fmt = CORE_PIXEL_FORMAT;
+         environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+      }
+   }
+
+   if (log_cb)
+      log_cb(RETRO_LOG_INFO, "Pixel format: %s\n",
+            frodo_rgb565 ? "RGB565" : "XRGB8888");
+#endif
+}
+
 static void (*pulse_handler)(int);
 
 void libretro_pulse_handler(void (*handler)(int))
@@ -596,7 +764,8 @@ void libretro_pulse_handler(void (*handler)(int))
 void retro_run(void)
 {
    static int pulse_counter = 0;
-   int x;
+   static int frame_count = 0;
+   bool skip_frame = false;
 
    bool updated = false;
 
@@ -607,30 +776,84 @@ void retro_run(void)
    if (pulse_counter > 20 && pulse_handler)
       pulse_handler(0);
 
-   if(pauseg==0)
+   // Simple frame delay approach: Only apply frameskip after initial boot time
+   frame_count++;
+
+   // Restored from the power-up snapshot: BASIC is already at READY,
+   // so neither the splash nor the boot delay is needed
+   if (TheC64 && TheC64->InstantBoot && frame_count <= 300)
+      frame_count = 301;
+
+   // Give the C64 300 frames (~6 seconds at 50fps) to complete boot sequence
+   bool allow_frameskip = (frame_count > 300);
+
+   // Frameskip logic - only apply when emulator is running AND after boot delay
+   if(pauseg==0 && frameskip_value > 0 && allow_frameskip)
    {
-      if(SND==1)
-         for(x=0;x<snd_sampler;x++)
-            audio_cb(SNDBUF[x],SNDBUF[x]);
-#ifdef NO_LIBCO
-#ifndef FRODO_SC
-      for(x=0;x<312;x++)
+      if (frameskip_counter < frameskip_value)
+      {
+         // Skip this frame - don't call video_cb at all
+         frameskip_counter++;
+         skip_frame = true;
+      }
+      else
+         // Render this frame and reset counter
+         frameskip_counter = 0;
+   }
+
+   // Emulated frames that get presented are drawn straight into the
+   // frontend's framebuffer, the GUI and the splash use Retro_Screen.
+   // Mostly static frames stay in our own buffer, so only the lines
+   // that changed need to be converted
+   bool emulated = (pauseg==0 && frame_count > 180);
+   select_output_buffer(emulated, emulated && !skip_frame
+         && (!can_dupe || Display_ChangedLines > retroh / 2));
+
+   if(pauseg==1)
+   {
+      // Option dialog open, run it until it polls for the next frame
+#ifndef NO_LIBCO
+      if(!guiThread)
+      {
+         mainThread = co_active();
+         guiThread  = co_create(65536*sizeof(void*), retro_wrap_gui);
+      }
+      co_switch(guiThread);
 #else
-         for(x=0;x<63*312;x++) 
-#endif
-            TheC64->thread_func();
+      pause_select();
 #endif
-   }   
+      Display_InvalidateOutput();
+   }
+   else if(pauseg==0 && TheC64)
+   {
+      // Emulate up to and including the next VBlank
+      Display_ChangedLines = -1;
+      if(!TheC64->RunFrame())
+      {
+         pauseg=-1;
+         environ_cb(RETRO_ENVIRONMENT_SHUTDOWN, 0);
+      }
 
-   // Simple frame delay approach: Only apply frameskip after initial boot time
-   static int frame_count = 0;
-   frame_count++;
+      // The sound of the frame just emulated, in stereo
+      if(SND==1)
+         audio_batch_cb(TheC64->SoundBuf, TheC64->SoundBufLen);
+
+      // The VIC skipped this frame, nothing new to show
+      if(Display_ChangedLines < 0)
+      {
+         if(can_dupe)
+            Display_ChangedLines = 0;
+         else if(TheC64)
+            TheC64->TheDisplay->Update();
+      }
+   }   
    
    // Show splash screen for first 180 frames (3 seconds at 60fps)
    if (frame_count <= 180)
    {
       draw_splash_screen();
-      video_cb(Retro_Screen,retrow,retroh,retrow<<PIXEL_BYTES);
+      present_frame();
+      Display_InvalidateOutput();
       
       // Upload silent audio samples during splash display
       // Commented because a buzzing noise is heard during splash in GB300
@@ -639,52 +862,23 @@ void retro_run(void)
 //         for(int x=0;x<snd_sampler;x++)
 //            audio_cb(0,0);
       
-      // Don't switch to emulator thread during splash - wait for core boot
       return;
    }
-   
-   // Give the C64 300 frames (~6 seconds at 50fps) to complete boot sequence
-   bool allow_frameskip = (frame_count > 300);
 
-   // Frameskip logic - only apply when emulator is running AND after boot delay
-   if(pauseg==0 && frameskip_value > 0 && allow_frameskip)
+   if (!skip_frame)
    {
-      if (frameskip_counter < frameskip_value)
-      {
-         // Skip this frame - don't call video_cb at all
-         frameskip_counter++;
-      }
+      // Nothing changed since the last frame, let the frontend dupe it
+      if (can_dupe && pauseg==0 && Display_ChangedLines == 0)
+         video_cb(NULL, retrow, retroh, 0);
       else
-      {
-         // Render this frame and reset counter
-         frameskip_counter = 0;
-         video_cb(Retro_Screen,retrow,retroh,retrow<<PIXEL_BYTES);
-      }
-   }
-   else
-   {
-      // Always render when paused/booting or frameskip disabled
-      video_cb(Retro_Screen,retrow,retroh,retrow<<PIXEL_BYTES);
+         present_frame();
    }
-
-#ifndef NO_LIBCO   
-   co_switch(emuThread);
-#endif
-
 }
 
 bool retro_load_game(const struct retro_game_info *info)
 {
    const char *full_path = NULL;
 
-#ifndef NO_LIBCO
-   if (!mainThread || !emuThread)
-   {
-      log_cb(RETRO_LOG_ERROR, "libco init failed\n", __LINE__);
-      return false;
-   }
-#endif
-
    if (info)
       full_path = info->path;
 
@@ -694,28 +888,21 @@ bool retro_load_game(const struct retro_game_info *info)
      memset(RPATH, 0, sizeof(RPATH));
 
    update_variables();
+   set_pixel_format();
 
-#ifdef RENDER16B
-	memset(Retro_Screen,0,1024*1024*2);
-#else
-	memset(Retro_Screen,0,1024*1024*2*2);
-#endif
-	memset(SNDBUF,0,1024*2*2);
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      can_dupe = false;
+
+	memset(Retro_Screen,0,sizeof(Retro_Screen));
 
-#ifndef NO_LIBCO
-	co_switch(emuThread);
-#else
 	Emu_init();
-#endif
    return true;
 }
 
 void retro_unload_game(void)
 {
    pauseg=0;
-#ifndef NO_LIBCO
-   shutdown_requested = true;
-#endif
+   quit_frodo_emu();
 }
 
 unsigned retro_get_region(void)
@@ -73,6 +73,108 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "auto"
    },
+   {
+      "frodo_pixel_format",
+      "Pixel Format (Restart)",
+      "Output pixels as 32-bit XRGB8888 or 16-bit RGB565. RGB565 halves the framebuffer bandwidth on low-end devices.",
+      {
+         { "xrgb8888", "32-bit (XRGB8888)" },
+         { "rgb565",   "16-bit (RGB565)" },
+         { NULL, NULL },
+      },
+      "xrgb8888"
+   },
+#ifdef FRODO_HYBRID
+   {
+      "frodo_engine",
+      "Emulation Engine",
+      "Auto runs the fast line-based emulation and switches to the cycle-exact Frodo SC engine while a program uses raster tricks like open side borders or FLD.",
+      {
+         { "auto", "Auto" },
+         { "line", "Line-based (fast)" },
+         { "sc",   "Cycle-exact (Frodo SC)" },
+         { NULL, NULL },
+      },
+      "auto"
+   },
+#endif
+   {
+      "frodo_sid",
+      "SID Emulation",
+      "Fast calculates the sound directly at the output rate for slow devices. Accurate calculates it at twice the standard rate, with less aliasing.",
+      {
+         { "fast",     "Fast" },
+         { "standard", "Standard" },
+         { "accurate", "Accurate" },
+         { NULL, NULL },
+      },
+#if defined(SF2000)
+      "fast"
+#else
+      "standard"
+#endif
+   },
+   {
+      "frodo_sid2",
+      "Second SID",
+      "Address of a second SID for stereo tunes and games, played on the right channel. It only calculates sound once a program writes to it, until then the right channel plays the first SID.",
+      {
+         { "none", "None" },
+         { "d420", "$D420" },
+         { "d440", "$D440" },
+         { "d500", "$D500" },
+         { "d600", "$D600" },
+         { "d700", "$D700" },
+         { "de00", "$DE00" },
+         { NULL, NULL },
+      },
+      "none"
+   },
+   {
+      "frodo_sid3",
+      "Third SID",
+      "Address of a third SID, played in the center at half volume, with or without a second SID. It only calculates sound once a program writes to it.",
+      {
+         { "none", "None" },
+         { "d420", "$D420" },
+         { "d440", "$D440" },
+         { "d500", "$D500" },
+         { "d600", "$D600" },
+         { "d700", "$D700" },
+         { "de00", "$DE00" },
+         { NULL, NULL },
+      },
+      "none"
+   },
+#ifdef HAVE_THREADS
+   {
+      "frodo_sid_thread",
+      "SID Worker Thread",
+      "Calculate the sound on another CPU core, which takes load off the emulation on multi-core devices. Delays the sound by one frame.",
+      {
+         { "false", "Off" },
+         { "true",  "On" },
+         { NULL, NULL },
+      },
+      "false"
+   },
+#endif
+#if !defined(SF2000)
+   {
+      "frodo_sample_rate",
+      "Audio Sample Rate",
+      "Sample rate of the sound output. Pick the rate of the audio driver, so the frontend doesn't have to resample.",
+      {
+         { "22050", "22050 Hz" },
+         { "32000", "32000 Hz" },
+         { "44100", "44100 Hz" },
+         { "48000", "48000 Hz" },
+         { "96000", "96000 Hz" },
+         { NULL, NULL },
+      },
+      "44100"
+   },
+#endif
    {
       "frodo_1541emul",
       "Enable processor-level 1541 emulation",